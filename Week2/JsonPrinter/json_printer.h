@@ -0,0 +1,204 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+#include <stdexcept>
+#include <sstream>
+#include <stack>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+
+inline void PrintJsonString(std::ostream& out, std::string_view str) {
+  out << "\"";
+  bool afterSlash = false;
+  for (auto c : str) {
+    if (afterSlash) {
+      out << '\\';
+      if (c != '\\' && c != '"') {
+        out << '\\';
+      }
+      else out << c;
+      afterSlash = false;
+    }
+    else if (c == '"') {
+      out << "\\\"";
+    }
+    else if (c == '\\') {
+      afterSlash = true;
+    }
+    else {
+      out << c;
+    }
+  }
+  if (afterSlash) out << "\\\\";
+  out << "\"";
+}
+
+namespace JsonContext {
+  template <class ParentContext> class Object;
+  template <class ParentContext> class Array;
+  template <class ParentObject> class ObjectValue;
+
+  static class Empty {} empty;
+
+  template <class ParentObject>
+  class ObjectValue {
+    ParentObject& parentObject_;
+    std::ostream& output_;
+
+    bool isPrinted = false;
+
+  public:
+    ObjectValue(std::ostream& output, ParentObject& parentObject)
+      : parentObject_(parentObject)
+      , output_{output}
+    {}
+    ~ObjectValue() {
+      if (!std::exchange(isPrinted, true)) {
+        Null();
+      }
+    }
+    ParentObject& Number(int64_t num) {
+      isPrinted = true;
+      output_ << num;
+      return parentObject_;
+    }
+    ParentObject& String(std::string_view str) {
+      isPrinted = true;
+      PrintJsonString(output_, str);
+      return parentObject_;
+    }
+    ParentObject& Boolean(bool b) {
+      isPrinted = true;
+      output_ << std::boolalpha << b;
+      return parentObject_;
+    }
+    ParentObject& Null() {
+      isPrinted = true;
+      output_ << "null";
+      return parentObject_;
+    }
+    Array<ParentObject> BeginArray() {
+      isPrinted = true;
+      return Array<ParentObject>(output_, parentObject_);
+    }
+    Object<ParentObject> BeginObject() {
+      isPrinted = true;
+      return Object<ParentObject>(output_, parentObject_);
+    }
+  };
+
+  template <class ParentContext>
+  class Object {
+    using Self = Object;
+
+    std::ostream& output_;
+    ParentContext& parentContext_;
+
+    bool isEmpty = true;
+    bool isFinished = false;
+
+  public:
+    Object(std::ostream& output, ParentContext& parentContext)
+      : output_(output)
+      , parentContext_(parentContext)
+    {
+      output_ << '{';
+    }
+
+    ~Object() {
+      EndObject();
+    }
+
+    ParentContext& EndObject() {
+      if (!std::exchange(isFinished, true)) {
+        output_ << '}';
+      }
+      return parentContext_;
+    }
+
+    ObjectValue<Self> Key(std::string_view str) {
+      if (!std::exchange(isEmpty, false)) {
+        output_ << ',';
+      }
+      PrintJsonString(output_, str);
+      output_ << ':';
+      return ObjectValue<Self>(output_, *this);
+    }
+  };
+
+  template <class ParentContext>
+  class Array {
+    using Self = Array;
+
+    std::ostream& output_;
+    ParentContext&  parentContext_;
+
+    bool isEmpty_ = true;
+    bool isFinished_ = false;
+
+    void BeforeValuePrint() {
+      if (!std::exchange(isEmpty_, false)) {
+        output_ << ',';
+      }
+    }
+
+  public:
+    Array(std::ostream& output, ParentContext& parentContext)
+      : output_(output)
+      , parentContext_(parentContext)
+    {
+      output_ << '[';
+    }
+
+    ~Array() {
+      EndArray();
+    }
+    ParentContext& EndArray() {
+      if (!std::exchange(isFinished_, true)) {
+        output_ << ']';
+      }
+      return parentContext_;
+    }
+    Self& Number(int n) {
+      BeforeValuePrint();
+      output_ << n;
+      return *this;
+    }
+    Self& String(std::string_view str) {
+      BeforeValuePrint();
+      PrintJsonString(output_, str);
+      return *this;
+    }
+    Self& Boolean(bool b) {
+      BeforeValuePrint();
+      output_ << std::boolalpha << b;
+      return *this;
+    }
+    Self& Null() {
+      BeforeValuePrint();
+      output_ << "null";
+      return *this;
+    }
+    Array<Self> BeginArray() {
+      BeforeValuePrint();
+      return Array<Self>(output_, *this);
+    }
+    Object<Self> BeginObject() {
+      BeforeValuePrint();
+      return Object<Self>(output_, *this);
+    }
+  };
+}
+
+using ArrayContext = JsonContext::Array<JsonContext::Empty>;
+inline ArrayContext PrintJsonArray(std::ostream& out) {
+  return JsonContext::Array<JsonContext::Empty>(out, JsonContext::empty);
+}
+
+using ObjectContext = JsonContext::Object<JsonContext::Empty>;
+inline ObjectContext PrintJsonObject(std::ostream& out) {
+  return JsonContext::Object<JsonContext::Empty>(out, JsonContext::empty);
+}
@@ -0,0 +1,165 @@
+#include "json_printer.h"
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Пишет в заранее выделенный буфер без перевыделений, в отличие от ostringstream
+class FixedBufferStreambuf : public streambuf {
+  vector<char> buffer_;
+
+public:
+  explicit FixedBufferStreambuf(size_t capacity)
+    : buffer_(capacity)
+  {
+    Reset();
+  }
+
+  void Reset() {
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+  }
+
+  size_t Size() const {
+    return pptr() - pbase();
+  }
+
+protected:
+  int_type overflow(int_type) override {
+    return traits_type::eof();
+  }
+};
+
+using Payload = function<void(ostream&)>;
+
+struct BenchmarkCase {
+  string name;
+  Payload print;
+};
+
+vector<int> GenerateInts(size_t count) {
+  mt19937 gen(42);
+  uniform_int_distribution<int> dist(numeric_limits<int>::min(), numeric_limits<int>::max());
+  vector<int> result(count);
+  for (auto& n : result) {
+    n = dist(gen);
+  }
+  return result;
+}
+
+vector<string> GenerateStrings(size_t count, size_t length, string_view alphabet) {
+  mt19937 gen(42);
+  uniform_int_distribution<size_t> dist(0, alphabet.size() - 1);
+  vector<string> result(count);
+  for (auto& s : result) {
+    s.reserve(length);
+    for (size_t i = 0; i < length; ++i) {
+      s.push_back(alphabet[dist(gen)]);
+    }
+  }
+  return result;
+}
+
+template <size_t Depth, class Context>
+void PrintNested(Context& context) {
+  context.Key("depth").Number(static_cast<int64_t>(Depth));
+  context.Key("flag").Boolean(Depth % 2 == 0);
+  if constexpr (Depth > 0) {
+    auto child = context.Key("child").BeginObject();
+    PrintNested<Depth - 1>(child);
+  }
+}
+
+vector<BenchmarkCase> MakeCases() {
+  constexpr size_t ItemCount = 200'000;
+
+  auto ints = GenerateInts(ItemCount);
+  auto shortStrings = GenerateStrings(ItemCount, 8, "abcdefghijklmnopqrstuvwxyz");
+  auto escapedStrings = GenerateStrings(ItemCount / 4, 32, "a\"\\\"\\b");
+
+  return {
+    {"ints", [ints = move(ints)](ostream& out) {
+      auto json = PrintJsonArray(out);
+      for (auto n : ints) {
+        json.Number(n);
+      }
+    }},
+    {"short strings", [strings = move(shortStrings)](ostream& out) {
+      auto json = PrintJsonArray(out);
+      for (auto& s : strings) {
+        json.String(s);
+      }
+    }},
+    {"escaped strings", [strings = move(escapedStrings)](ostream& out) {
+      auto json = PrintJsonArray(out);
+      for (auto& s : strings) {
+        json.String(s);
+      }
+    }},
+    {"nested objects", [](ostream& out) {
+      auto json = PrintJsonArray(out);
+      for (size_t i = 0; i < ItemCount / 64; ++i) {
+        auto object = json.BeginObject();
+        PrintNested<32>(object);
+      }
+    }},
+  };
+}
+
+template <class Func>
+double MeasureSeconds(int iterations, Func func) {
+  auto start = chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    func();
+  }
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+void RunCase(const BenchmarkCase& benchmarkCase, int iterations) {
+  size_t bytes = 0;
+  double streamSeconds = MeasureSeconds(iterations, [&] {
+    ostringstream out;
+    benchmarkCase.print(out);
+    bytes = out.str().size();
+  });
+
+  FixedBufferStreambuf buffer(bytes);
+  ostream bufferOut(&buffer);
+  double bufferSeconds = MeasureSeconds(iterations, [&] {
+    buffer.Reset();
+    benchmarkCase.print(bufferOut);
+  });
+  if (!bufferOut || buffer.Size() != bytes) {
+    throw runtime_error("Buffer output mismatch in " + benchmarkCase.name);
+  }
+
+  double megabytes = static_cast<double>(bytes) * iterations / (1024 * 1024);
+  cout << setw(16) << left << benchmarkCase.name << right
+       << setw(12) << bytes
+       << setw(14) << fixed << setprecision(1) << megabytes / streamSeconds
+       << setw(14) << megabytes / bufferSeconds
+       << endl;
+}
+
+int main(int argc, char* argv[]) {
+  int iterations = argc > 1 ? stoi(argv[1]) : 10;
+
+  cout << setw(16) << left << "case" << right
+       << setw(12) << "bytes"
+       << setw(14) << "ostream MB/s"
+       << setw(14) << "buffer MB/s"
+       << endl;
+  for (const auto& benchmarkCase : MakeCases()) {
+    RunCase(benchmarkCase, iterations);
+  }
+  return 0;
+}
@@ -0,0 +1,46 @@
+#include "case_folding.h"
+
+using namespace std;
+
+namespace {
+  char32_t FoldCodePoint(char32_t c) {
+    if (c >= U'A' && c <= U'Z') {
+      return c + 0x20;
+    }
+    if (c >= 0xC0 && c <= 0xDE && c != 0xD7) {
+      return c + 0x20;
+    }
+    if (c >= 0x410 && c <= 0x42F) {
+      return c + 0x20;
+    }
+    if (c >= 0x400 && c <= 0x40F) {
+      return c + 0x50;
+    }
+    return c;
+  }
+}
+
+string FoldCase(string_view utf8) {
+  string result;
+  result.reserve(utf8.size());
+
+  for (size_t i = 0; i < utf8.size(); ++i) {
+    auto lead = static_cast<unsigned char>(utf8[i]);
+    if (lead < 0x80) {
+      result.push_back(static_cast<char>(FoldCodePoint(lead)));
+      continue;
+    }
+
+    // Регистр у поддерживаемых символов есть только среди двухбайтовых последовательностей
+    auto next = i + 1 < utf8.size() ? static_cast<unsigned char>(utf8[i + 1]) : 0;
+    if ((lead & 0xE0) != 0xC0 || (next & 0xC0) != 0x80) {
+      result.push_back(utf8[i]);
+      continue;
+    }
+    char32_t c = FoldCodePoint((char32_t(lead & 0x1F) << 6) | (next & 0x3F));
+    result.push_back(static_cast<char>(0xC0 | (c >> 6)));
+    result.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+    ++i;
+  }
+  return result;
+}
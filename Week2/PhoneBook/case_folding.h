@@ -0,0 +1,9 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// Приводит UTF-8 строку к нижнему регистру для поиска без учёта регистра.
+// Учитываются латиница (включая Latin-1) и кириллица; остальные символы и
+// некорректные последовательности байт копируются как есть.
+std::string FoldCase(std::string_view utf8);
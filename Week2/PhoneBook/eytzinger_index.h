@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <ranges>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <sys/mman.h>
+
+// Индекс для поиска по префиксу над отсортированным массивом имён без обращения
+// к самим строкам. Первые KeyBytes байт каждого имени упакованы в big-endian
+// число, так что порядок ключей совпадает с порядком имён, и ключи разложены в
+// порядке Эйтцингера (неявное двоичное дерево в массиве). Спуск по такому
+// массиву идёт сверху вниз с предвыборкой на несколько уровней вперёд, а узлы
+// верхних уровней всегда лежат в кэше.
+//
+// Префикс не длиннее KeyBytes и без нулевых байт ищется только по ключам. Для
+// более длинного префикса (или префикса с нулевым байтом) ключи дают диапазон
+// имён с теми же первыми байтами, внутри которого имена сравниваются целиком
+// через NameAt(size_t).
+class EytzingerIndex {
+public:
+  using Range = std::pair<size_t, size_t>;
+
+  static constexpr size_t KeyBytes = sizeof(uint64_t);
+
+  EytzingerIndex() = default;
+
+  template <class NameAt>
+  EytzingerIndex(size_t count, NameAt name_at);
+
+  template <class NameAt>
+  Range Find(std::string_view prefix, NameAt name_at) const;
+
+  static uint64_t Key(std::string_view name) {
+    uint64_t key = 0;
+    for (size_t i = 0; i < KeyBytes; ++i) {
+      key = (key << 8) | (i < name.size() ? static_cast<unsigned char>(name[i]) : 0);
+    }
+    return key;
+  }
+
+private:
+  // Выравнивает массив ключей по кэш-линии, а большие массивы — по huge page и
+  // просит ядро подложить под них huge pages, чтобы спуск не упирался в TLB
+  template <class T>
+  struct Allocator {
+    using value_type = T;
+
+    static constexpr size_t CacheLine = 64;
+    static constexpr size_t HugePage = 2 << 20;
+
+    Allocator() = default;
+    template <class U>
+    Allocator(const Allocator<U>&) {}
+
+    static size_t Alignment(size_t bytes) {
+      return bytes >= HugePage ? HugePage : CacheLine;
+    }
+
+    T* allocate(size_t n) {
+      size_t bytes = n * sizeof(T);
+      void* p = ::operator new(bytes, std::align_val_t(Alignment(bytes)));
+#ifdef MADV_HUGEPAGE
+      if (bytes >= HugePage) {
+        madvise(p, bytes, MADV_HUGEPAGE);
+      }
+#endif
+      return static_cast<T*>(p);
+    }
+
+    void deallocate(T* p, size_t n) {
+      ::operator delete(p, std::align_val_t(Alignment(n * sizeof(T))));
+    }
+
+    bool operator==(const Allocator&) const = default;
+  };
+
+  // Номер в отсортированном массиве первого ключа не меньше key
+  size_t LowerBound(uint64_t key) const;
+  // Номер первого ключа, больше key
+  size_t UpperBound(uint64_t key) const;
+
+  size_t Fill(const std::vector<uint64_t>& sorted, size_t rank, size_t node);
+
+  // Узел k имеет детей 2k и 2k + 1, нулевой элемент не используется
+  std::vector<uint64_t, Allocator<uint64_t>> keys_;
+  std::vector<uint32_t> ranks_;
+};
+
+template <class NameAt>
+EytzingerIndex::EytzingerIndex(size_t count, NameAt name_at)
+  : keys_(count + 1)
+  , ranks_(count + 1)
+{
+  std::vector<uint64_t> sorted(count);
+  for (size_t i = 0; i < count; ++i) {
+    sorted[i] = Key(name_at(i));
+  }
+  Fill(sorted, 0, 1);
+}
+
+inline size_t EytzingerIndex::Fill(const std::vector<uint64_t>& sorted, size_t rank, size_t node) {
+  if (node < keys_.size()) {
+    rank = Fill(sorted, rank, 2 * node);
+    keys_[node] = sorted[rank];
+    ranks_[node] = static_cast<uint32_t>(rank);
+    rank = Fill(sorted, rank + 1, 2 * node + 1);
+  }
+  return rank;
+}
+
+inline size_t EytzingerIndex::LowerBound(uint64_t key) const {
+  const uint64_t* keys = keys_.data();
+  size_t count = keys_.size() - 1;
+  size_t node = 1;
+  while (node <= count) {
+    // Потомки узла через три уровня занимают одну кэш-линию
+    __builtin_prefetch(keys + 8 * node);
+    node = 2 * node + (keys[node] < key);
+  }
+  // Последний поворот налево был в искомом узле
+  node >>= std::countr_one(node) + 1;
+  return node == 0 ? count : ranks_[node];
+}
+
+inline size_t EytzingerIndex::UpperBound(uint64_t key) const {
+  return key == std::numeric_limits<uint64_t>::max() ? keys_.size() - 1 : LowerBound(key + 1);
+}
+
+template <class NameAt>
+EytzingerIndex::Range EytzingerIndex::Find(std::string_view prefix, NameAt name_at) const {
+  if (keys_.empty()) {
+    return {0, 0};
+  }
+
+  // Байты префикса, которые можно сравнить по ключам: нулевой байт неотличим
+  // от дополнения короткого имени
+  auto head = prefix.substr(0, KeyBytes);
+  head = head.substr(0, head.find('\0'));
+  uint64_t first = Key(head);
+  uint64_t last = first | (head.size() == KeyBytes ? 0 : ~uint64_t(0) >> (8 * head.size()));
+  Range range{LowerBound(first), UpperBound(last)};
+  if (head.size() == prefix.size()) {
+    return range;
+  }
+
+  // Ключи совпали, дальше сравниваем имена целиком, обрезая их до длины префикса
+  auto found = std::ranges::equal_range(
+    std::views::iota(range.first, range.second), prefix, {},
+    [&](size_t i) { return name_at(i).substr(0, prefix.size()); }
+  );
+  return {*found.begin(), *found.end()};
+}
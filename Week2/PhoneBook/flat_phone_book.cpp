@@ -0,0 +1,412 @@
+#include "flat_phone_book.h"
+#include "phone_number.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace FlatPhoneBookFormat {
+  constexpr char Magic[8] = {'P', 'H', 'O', 'N', 'E', 'B', 'K', '\0'};
+  constexpr uint32_t ByteOrderMark = 0x01020304;
+  constexpr uint32_t Version = 2;
+
+  struct Header {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint64_t contact_count;
+    uint64_t phone_count;
+    uint64_t template_count;
+    uint64_t names_size;
+    uint64_t phones_size;
+    uint64_t templates_size;
+  };
+
+  struct PackedDate {
+    int32_t year;
+    uint8_t month, day;
+    uint8_t has_value;
+    uint8_t reserved;
+  };
+
+  // Секции идут в фиксированном порядке, каждая выровнена на 8 байт
+  struct Layout {
+    size_t name_offsets, birthdays, phone_ranges, phone_offsets, template_offsets;
+    size_t names, phones, templates, total;
+  };
+
+  size_t Align(size_t offset) {
+    return (offset + 7) & ~size_t(7);
+  }
+
+  // Размеры считаются с проверкой переполнения: иначе подобранный заголовок
+  // мог бы «уместить» секции в файл, который меньше их
+  [[noreturn]] void ThrowCorrupted() {
+    throw runtime_error("Flat phone book header is corrupted");
+  }
+
+  uint64_t CheckedAdd(uint64_t lhs, uint64_t rhs) {
+    if (lhs > UINT64_MAX - rhs) {
+      ThrowCorrupted();
+    }
+    return lhs + rhs;
+  }
+
+  uint64_t CheckedMul(uint64_t lhs, uint64_t rhs) {
+    if (rhs != 0 && lhs > UINT64_MAX / rhs) {
+      ThrowCorrupted();
+    }
+    return lhs * rhs;
+  }
+
+  // Начало следующей секции: offset + count элементов size байт, с выравниванием
+  uint64_t Next(uint64_t offset, uint64_t count, uint64_t size) {
+    auto end = CheckedAdd(offset, CheckedMul(count, size));
+    CheckedAdd(end, 7);
+    return Align(end);
+  }
+
+  Layout ComputeLayout(const Header& header) {
+    Layout layout{};
+    layout.name_offsets = Align(sizeof(Header));
+    layout.birthdays = Next(layout.name_offsets, CheckedAdd(header.contact_count, 1), sizeof(uint64_t));
+    layout.phone_ranges = Next(layout.birthdays, header.contact_count, sizeof(PackedDate));
+    layout.phone_offsets = Next(layout.phone_ranges, CheckedAdd(header.contact_count, 1), sizeof(uint32_t));
+    layout.template_offsets = Next(layout.phone_offsets, CheckedAdd(header.phone_count, 1), sizeof(uint64_t));
+    layout.names = Next(layout.template_offsets, CheckedAdd(header.template_count, 1), sizeof(uint64_t));
+    layout.phones = Next(layout.names, header.names_size, 1);
+    layout.templates = Next(layout.phones, header.phones_size, 1);
+    layout.total = Next(layout.templates, header.templates_size, 1);
+    return layout;
+  }
+
+  // Таблица смещений из count + 1 элементов: от нуля, не убывает, заканчивается на size
+  template <typename T>
+  bool IsOffsetTable(const T* offsets, uint64_t count, uint64_t size) {
+    if (offsets[0] != 0 || offsets[count] != size) {
+      return false;
+    }
+    for (uint64_t i = 0; i < count; ++i) {
+      if (offsets[i] > offsets[i + 1]) {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+using namespace FlatPhoneBookFormat;
+
+namespace {
+  template <typename T>
+  void WriteSection(ostream& output, const vector<T>& items) {
+    output.write(reinterpret_cast<const char*>(items.data()), items.size() * sizeof(T));
+  }
+
+  void WritePadding(ostream& output, size_t written) {
+    static const char zeros[8] = {};
+    output.write(zeros, Align(written) - written);
+  }
+}
+
+FlatPhoneBook::FlatPhoneBook(shared_ptr<const void> storage, string_view data)
+  : storage_(move(storage))
+  , data_(data)
+{
+  if (data_.size() < sizeof(Header)) {
+    throw runtime_error("Flat phone book is truncated");
+  }
+  header_ = reinterpret_cast<const Header*>(data_.data());
+  if (memcmp(header_->magic, Magic, sizeof(Magic)) != 0) {
+    throw runtime_error("Not a flat phone book");
+  }
+  if (header_->byte_order != ByteOrderMark) {
+    throw runtime_error("Flat phone book has foreign byte order");
+  }
+  if (header_->version != Version) {
+    throw runtime_error("Unsupported flat phone book version");
+  }
+
+  auto layout = ComputeLayout(*header_);
+  if (data_.size() < layout.total) {
+    throw runtime_error("Flat phone book is truncated");
+  }
+  name_offsets_ = reinterpret_cast<const uint64_t*>(data_.data() + layout.name_offsets);
+  birthdays_ = reinterpret_cast<const PackedDate*>(data_.data() + layout.birthdays);
+  phone_ranges_ = reinterpret_cast<const uint32_t*>(data_.data() + layout.phone_ranges);
+  phone_offsets_ = reinterpret_cast<const uint64_t*>(data_.data() + layout.phone_offsets);
+  template_offsets_ = reinterpret_cast<const uint64_t*>(data_.data() + layout.template_offsets);
+  names_ = data_.data() + layout.names;
+  phones_ = data_.data() + layout.phones;
+  templates_ = data_.data() + layout.templates;
+
+  // Здесь только то, что проверяется за O(1): таблицы целиком читает Validate,
+  // а отдельные записи проверяются при обращении к ним
+  if (header_->phone_count > UINT32_MAX
+      || name_offsets_[header_->contact_count] != header_->names_size
+      || phone_ranges_[header_->contact_count] != header_->phone_count
+      || phone_offsets_[header_->phone_count] != header_->phones_size
+      || template_offsets_[header_->template_count] != header_->templates_size) {
+    throw runtime_error("Flat phone book offset tables are corrupted");
+  }
+}
+
+void FlatPhoneBook::Validate() const {
+  if (!IsOffsetTable(name_offsets_, header_->contact_count, header_->names_size)
+      || !IsOffsetTable(phone_ranges_, header_->contact_count, header_->phone_count)
+      || !IsOffsetTable(phone_offsets_, header_->phone_count, header_->phones_size)
+      || !IsOffsetTable(template_offsets_, header_->template_count, header_->templates_size)) {
+    throw runtime_error("Flat phone book offset tables are corrupted");
+  }
+
+  // Каждый номер ссылается на существующий шаблон, и цифр в нём хватает на все
+  // места для цифр шаблона
+  vector<uint64_t> placeholders(header_->template_count);
+  for (uint64_t id = 0; id < header_->template_count; ++id) {
+    auto pattern = TemplateAt(static_cast<uint32_t>(id));
+    placeholders[id] = count(pattern.begin(), pattern.end(), PhoneNumber::DigitPlaceholder);
+  }
+  for (uint64_t phone = 0; phone < header_->phone_count; ++phone) {
+    auto packed = PackedPhoneAt(phone);
+    auto size = packed.size();
+    uint32_t id = PhoneNumber::Detail::ReadVarint(packed);
+    if (size == 0 || (id != PhoneNumber::RawTemplateId
+                      && (id >= header_->template_count || placeholders[id] > 2 * packed.size()))) {
+      throw runtime_error("Flat phone book phone is corrupted");
+    }
+  }
+}
+
+FlatPhoneBook FlatPhoneBook::Map(const string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw runtime_error("Cannot open " + path);
+  }
+  struct stat info{};
+  if (fstat(fd, &info) != 0 || info.st_size == 0) {
+    close(fd);
+    throw runtime_error("Cannot map " + path);
+  }
+  auto size = static_cast<size_t>(info.st_size);
+  void* address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (address == MAP_FAILED) {
+    throw runtime_error("Cannot map " + path);
+  }
+
+  shared_ptr<const void> mapping(address, [size](const void* p) {
+    munmap(const_cast<void*>(p), size);
+  });
+  return FlatPhoneBook(move(mapping), string_view(static_cast<const char*>(address), size));
+}
+
+FlatPhoneBook FlatPhoneBook::Build(const PhoneBook& book) {
+  ostringstream output(ios::binary);
+  SaveFlatPhoneBook(book, output);
+  auto image = make_shared<const string>(move(output).str());
+  string_view data(*image);
+  return FlatPhoneBook(move(image), data);
+}
+
+FlatPhoneBook FlatPhoneBook::Build(PhoneBook::Contacts contacts) {
+  return Build(PhoneBook(move(contacts), {.cache_capacity = 0}));
+}
+
+size_t FlatPhoneBook::size() const {
+  return header_->contact_count;
+}
+
+size_t FlatPhoneBook::ByteSize() const {
+  return data_.size();
+}
+
+FlatPhoneBook::ContactView FlatPhoneBook::operator[](size_t index) const {
+  return ContactView(*this, index);
+}
+
+namespace {
+  [[noreturn]] void ThrowCorruptedRecord() {
+    throw runtime_error("Flat phone book record is corrupted");
+  }
+
+  // Отрезок [offsets[index], offsets[index + 1]) внутри секции из size байт
+  template <typename T>
+  pair<uint64_t, uint64_t> Slice(const T* offsets, size_t index, uint64_t size) {
+    uint64_t first = offsets[index], last = offsets[index + 1];
+    if (first > last || last > size) {
+      ThrowCorruptedRecord();
+    }
+    return {first, last};
+  }
+}
+
+string_view FlatPhoneBook::NameAt(size_t index) const {
+  auto [first, last] = Slice(name_offsets_, index, header_->names_size);
+  return string_view(names_ + first, last - first);
+}
+
+FlatPhoneBook::ContactRange FlatPhoneBook::FindByNamePrefix(string_view name_prefix) const {
+  // Как std::equal_range: сужаем диапазон, пока не встретим имя с нужным префиксом,
+  // а затем ищем границы только слева и справа от него
+  auto compare = [&](size_t index) {
+    return NameAt(index).substr(0, name_prefix.size()).compare(name_prefix);
+  };
+
+  size_t first = 0, last = size();
+  while (first < last) {
+    size_t middle = first + (last - first) / 2;
+    int order = compare(middle);
+    if (order < 0) {
+      first = middle + 1;
+    } else if (order > 0) {
+      last = middle;
+    } else {
+      size_t lower = first, upper = middle;
+      while (lower < upper) {
+        size_t m = lower + (upper - lower) / 2;
+        if (compare(m) < 0) {
+          lower = m + 1;
+        } else {
+          upper = m;
+        }
+      }
+      first = lower;
+      lower = middle + 1;
+      upper = last;
+      while (lower < upper) {
+        size_t m = lower + (upper - lower) / 2;
+        if (compare(m) == 0) {
+          lower = m + 1;
+        } else {
+          upper = m;
+        }
+      }
+      last = lower;
+      break;
+    }
+  }
+  return ContactRange(Iterator(*this, first), Iterator(*this, last));
+}
+
+string_view FlatPhoneBook::ContactView::Name() const {
+  return book_->NameAt(index_);
+}
+
+optional<Date> FlatPhoneBook::ContactView::Birthday() const {
+  const auto& date = book_->birthdays_[index_];
+  if (!date.has_value) {
+    return nullopt;
+  }
+  return Date{date.year, date.month, date.day};
+}
+
+size_t FlatPhoneBook::ContactView::PhoneCount() const {
+  auto [first, last] = Slice(book_->phone_ranges_, index_, book_->header_->phone_count);
+  return last - first;
+}
+
+string_view FlatPhoneBook::PackedPhoneAt(size_t phone) const {
+  // Номер телефона берётся из phone_ranges_, то есть тоже из файла
+  if (phone >= header_->phone_count) {
+    ThrowCorruptedRecord();
+  }
+  auto [first, last] = Slice(phone_offsets_, phone, header_->phones_size);
+  return string_view(phones_ + first, last - first);
+}
+
+string_view FlatPhoneBook::TemplateAt(uint32_t id) const {
+  if (id >= header_->template_count) {
+    ThrowCorruptedRecord();
+  }
+  auto [first, last] = Slice(template_offsets_, id, header_->templates_size);
+  return string_view(templates_ + first, last - first);
+}
+
+string FlatPhoneBook::ContactView::Phone(size_t i) const {
+  auto packed = book_->PackedPhoneAt(book_->phone_ranges_[index_] + i);
+  return PhoneNumber::Decode(packed, [this](uint32_t id) {
+    return book_->TemplateAt(id);
+  });
+}
+
+string FlatPhoneBook::ContactView::PhoneDigits(size_t i) const {
+  return PhoneNumber::DecodeDigits(book_->PackedPhoneAt(book_->phone_ranges_[index_] + i));
+}
+
+void SaveFlatPhoneBook(const PhoneBook& book, ostream& output) {
+  auto contacts = book.FindByNamePrefix("");
+
+  vector<uint64_t> nameOffsets = {0};
+  vector<PackedDate> birthdays;
+  vector<uint32_t> phoneRanges = {0};
+  vector<uint64_t> phoneOffsets = {0};
+  string phones;
+  PhoneNumber::TemplateTable templates;
+  nameOffsets.reserve(contacts.size() + 1);
+  birthdays.reserve(contacts.size());
+  phoneRanges.reserve(contacts.size() + 1);
+
+  for (const auto& contact : contacts) {
+    nameOffsets.push_back(nameOffsets.back() + contact.name.size());
+    auto& birthday = birthdays.emplace_back();
+    if (contact.birthday) {
+      birthday.year = contact.birthday->year;
+      birthday.month = static_cast<uint8_t>(contact.birthday->month);
+      birthday.day = static_cast<uint8_t>(contact.birthday->day);
+      birthday.has_value = 1;
+    }
+    for (const auto& phone : contact.phones) {
+      templates.Encode(phone, phones);
+      phoneOffsets.push_back(phones.size());
+    }
+    phoneRanges.push_back(static_cast<uint32_t>(phoneOffsets.size() - 1));
+  }
+
+  vector<uint64_t> templateOffsets = {0};
+  for (const auto& pattern : templates.Templates()) {
+    templateOffsets.push_back(templateOffsets.back() + pattern.size());
+  }
+
+  Header header{};
+  memcpy(header.magic, Magic, sizeof(Magic));
+  header.byte_order = ByteOrderMark;
+  header.version = Version;
+  header.contact_count = contacts.size();
+  header.phone_count = phoneOffsets.size() - 1;
+  header.template_count = templateOffsets.size() - 1;
+  header.names_size = nameOffsets.back();
+  header.phones_size = phones.size();
+  header.templates_size = templateOffsets.back();
+
+  output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  WritePadding(output, sizeof(header));
+  WriteSection(output, nameOffsets);
+  WritePadding(output, nameOffsets.size() * sizeof(uint64_t));
+  WriteSection(output, birthdays);
+  WritePadding(output, birthdays.size() * sizeof(PackedDate));
+  WriteSection(output, phoneRanges);
+  WritePadding(output, phoneRanges.size() * sizeof(uint32_t));
+  WriteSection(output, phoneOffsets);
+  WritePadding(output, phoneOffsets.size() * sizeof(uint64_t));
+  WriteSection(output, templateOffsets);
+  WritePadding(output, templateOffsets.size() * sizeof(uint64_t));
+  for (const auto& contact : contacts) {
+    output.write(contact.name.data(), contact.name.size());
+  }
+  WritePadding(output, header.names_size);
+  output.write(phones.data(), phones.size());
+  WritePadding(output, header.phones_size);
+  for (const auto& pattern : templates.Templates()) {
+    output.write(pattern.data(), pattern.size());
+  }
+  WritePadding(output, header.templates_size);
+}
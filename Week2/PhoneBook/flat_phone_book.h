@@ -0,0 +1,135 @@
+#pragma once
+
+#include "iterator_range.h"
+#include "phone_book.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace FlatPhoneBookFormat {
+  struct Header;
+  struct PackedDate;
+}
+
+// Плоский формат телефонной книги для отображения в память.
+// Контакты отсортированы по имени, все имена лежат подряд в одном блоке, телефоны
+// в другом, а таблицы смещений позволяют обращаться к любому полю по индексу
+// контакта без разбора и копирования. Телефоны хранятся упакованными
+// (см. phone_number.h): цифры по две в байте плюс ссылка на общий шаблон. Загрузка сводится к mmap и проверке
+// заголовка, а страницы файла разделяются между процессами и читаются по мере обращения.
+//
+// Тот же образ можно построить прямо в памяти (Build): тогда это компактное
+// хранилище контактов — два пула строк и массивы смещений вместо отдельных
+// std::string и std::vector на каждый контакт.
+//
+// Числа хранятся в порядке байт машины, на которой файл был записан.
+class FlatPhoneBook {
+public:
+  class ContactView {
+  public:
+    ContactView(const FlatPhoneBook& book, size_t index)
+      : book_(&book)
+      , index_(index)
+    {}
+
+    std::string_view Name() const;
+    std::optional<Date> Birthday() const;
+    size_t PhoneCount() const;
+    // Номер в исходном виде, восстановленный из упакованного представления
+    std::string Phone(size_t i) const;
+    // Только цифры номера, без восстановления форматирования
+    std::string PhoneDigits(size_t i) const;
+
+  private:
+    const FlatPhoneBook* book_;
+    size_t index_;
+  };
+
+  class Iterator {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = ContactView;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = ContactView;
+
+    Iterator() = default;
+    Iterator(const FlatPhoneBook& book, size_t index) : book_(&book), index_(index) {}
+
+    ContactView operator*() const { return ContactView(*book_, index_); }
+    ContactView operator[](difference_type n) const { return ContactView(*book_, index_ + n); }
+
+    Iterator& operator++() { ++index_; return *this; }
+    Iterator operator++(int) { auto old = *this; ++index_; return old; }
+    Iterator& operator--() { --index_; return *this; }
+    Iterator operator--(int) { auto old = *this; --index_; return old; }
+    Iterator& operator+=(difference_type n) { index_ += n; return *this; }
+    Iterator& operator-=(difference_type n) { index_ -= n; return *this; }
+    Iterator operator+(difference_type n) const { return Iterator(*book_, index_ + n); }
+    Iterator operator-(difference_type n) const { return Iterator(*book_, index_ - n); }
+    friend Iterator operator+(difference_type n, const Iterator& it) { return it + n; }
+    difference_type operator-(const Iterator& other) const {
+      return static_cast<difference_type>(index_) - static_cast<difference_type>(other.index_);
+    }
+
+    bool operator==(const Iterator& other) const { return index_ == other.index_; }
+    auto operator<=>(const Iterator& other) const { return index_ <=> other.index_; }
+
+  private:
+    const FlatPhoneBook* book_ = nullptr;
+    size_t index_ = 0;
+  };
+
+  using ContactRange = IteratorRange<Iterator>;
+
+  // Отображает файл в память за O(1): проверяются только заголовок и границы
+  // секций. Повреждённая запись обнаруживается при обращении к ней —
+  // ContactView и FindByNamePrefix бросают std::runtime_error.
+  static FlatPhoneBook Map(const std::string& path);
+
+  // Строит образ в памяти
+  static FlatPhoneBook Build(const PhoneBook& book);
+  static FlatPhoneBook Build(PhoneBook::Contacts contacts);
+
+  size_t size() const;
+  // Размер образа в байтах
+  size_t ByteSize() const;
+  ContactView operator[](size_t index) const;
+
+  ContactRange FindByNamePrefix(std::string_view name_prefix) const;
+
+  // Проверяет весь образ — таблицы смещений и ссылки номеров на шаблоны — и
+  // бросает std::runtime_error, если он повреждён. Один проход по таблицам и
+  // телефонам, без разбора имён; нужен, если файлу нет доверия.
+  void Validate() const;
+
+private:
+  FlatPhoneBook(std::shared_ptr<const void> storage, std::string_view data);
+
+  std::string_view NameAt(size_t index) const;
+  std::string_view PackedPhoneAt(size_t phone) const;
+  std::string_view TemplateAt(uint32_t id) const;
+
+  // Владеет отображением (или буфером) с данными, на которые указывает data_
+  std::shared_ptr<const void> storage_;
+  std::string_view data_;
+
+  const FlatPhoneBookFormat::Header* header_;
+  const uint64_t* name_offsets_;
+  const FlatPhoneBookFormat::PackedDate* birthdays_;
+  const uint32_t* phone_ranges_;
+  const uint64_t* phone_offsets_;
+  const uint64_t* template_offsets_;
+  const char* names_;
+  const char* phones_;
+  const char* templates_;
+};
+
+// Записывает книгу в плоском формате, пригодном для FlatPhoneBook::Map
+void SaveFlatPhoneBook(const PhoneBook& book, std::ostream& output);
@@ -7,8 +7,6 @@ class IteratorRange {
 public:
   IteratorRange(It first, It last) : first(first), last(last) {}
 
-  IteratorRange(const IteratorRange& r) : first(r.first), last(r.last) {}
-
   It begin() const {
     return first;
   }
@@ -0,0 +1,68 @@
+#include "live_phone_book.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// Дельта вливается, когда превышает и этот размер, и 1/DeltaRatio основной книги,
+// так что на каждое добавление приходится O(DeltaRatio) перемещённых контактов
+constexpr size_t MinMaxDeltaSize = 4096;
+constexpr size_t DeltaRatio = 32;
+
+LivePhoneBook::LivePhoneBook(PhoneBook::Contacts contacts, PhoneBookOptions options)
+  : base_(move(contacts), options)
+{}
+
+LivePhoneBook::LivePhoneBook(PhoneBook book)
+  : base_(move(book))
+{}
+
+void LivePhoneBook::Add(Contact contact) {
+  delta_.insert(move(contact));
+  if (delta_.size() > MaxDeltaSize()) {
+    Compact();
+  }
+}
+
+void LivePhoneBook::Compact() {
+  if (delta_.empty()) {
+    return;
+  }
+
+  auto& base = base_.sorted_contacts_;
+  PhoneBook::Contacts merged;
+  merged.reserve(base.size() + delta_.size());
+
+  auto it = base.begin();
+  while (!delta_.empty()) {
+    auto& next = *delta_.begin();
+    auto last = upper_bound(it, base.end(), next, ContactNameCompare());
+    merged.insert(merged.end(), make_move_iterator(it), make_move_iterator(last));
+    it = last;
+    merged.push_back(move(delta_.extract(delta_.begin()).value()));
+  }
+  merged.insert(merged.end(), make_move_iterator(it), make_move_iterator(base.end()));
+
+  base_ = PhoneBook(move(merged), 0, base_.options_);
+}
+
+LivePhoneBook::ContactRange LivePhoneBook::FindByNamePrefix(string_view name_prefix) const {
+  auto base = base_.FindByNamePrefix(name_prefix);
+  auto [first, last] = delta_.equal_range(name_prefix);
+  return ContactRange(
+    Iterator(base, first, last),
+    Iterator(PhoneBook::ContactRange(base.end(), base.end()), last, last)
+  );
+}
+
+size_t LivePhoneBook::size() const {
+  return base_.sorted_contacts_.size() + delta_.size();
+}
+
+size_t LivePhoneBook::DeltaSize() const {
+  return delta_.size();
+}
+
+size_t LivePhoneBook::MaxDeltaSize() const {
+  return max(MinMaxDeltaSize, base_.sorted_contacts_.size() / DeltaRatio);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "iterator_range.h"
+#include "phone_book.h"
+
+#include <cstddef>
+#include <iterator>
+#include <set>
+#include <string_view>
+
+// Телефонная книга с добавлением контактов без полной пересортировки.
+// Новые контакты попадают в небольшое упорядоченное дельта-множество, а поиск
+// по префиксу сливает на лету диапазон основной книги и диапазон дельты. Когда
+// дельта вырастает, она вливается в основной массив одним линейным слиянием.
+//
+// Add и Compact инвалидируют ранее полученные диапазоны и не должны выполняться
+// одновременно с поиском; сам поиск можно вести из нескольких потоков.
+class LivePhoneBook {
+public:
+  using Delta = std::multiset<Contact, ContactNameCompare>;
+
+  // Обходит два отсортированных диапазона как один; при равных именах
+  // контакты основной книги идут первыми
+  class Iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Contact;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const Contact*;
+    using reference = const Contact&;
+
+    Iterator() = default;
+    Iterator(PhoneBook::ContactRange base, Delta::const_iterator delta, Delta::const_iterator delta_end)
+      : base_(base.begin()), base_end_(base.end()), delta_(delta), delta_end_(delta_end)
+    {}
+
+    reference operator*() const { return FromBase() ? *base_ : *delta_; }
+    pointer operator->() const { return &**this; }
+
+    Iterator& operator++() {
+      if (FromBase()) {
+        ++base_;
+      } else {
+        ++delta_;
+      }
+      return *this;
+    }
+    Iterator operator++(int) { auto old = *this; ++*this; return old; }
+
+    // Линейно по числу элементов дельты между итераторами
+    difference_type operator-(const Iterator& other) const {
+      return (base_ - other.base_) + std::distance(other.delta_, delta_);
+    }
+
+    bool operator==(const Iterator& other) const {
+      return base_ == other.base_ && delta_ == other.delta_;
+    }
+
+  private:
+    bool FromBase() const {
+      return delta_ == delta_end_ || (base_ != base_end_ && !(delta_->name < base_->name));
+    }
+
+    PhoneBook::Contacts::const_iterator base_, base_end_;
+    Delta::const_iterator delta_, delta_end_;
+  };
+
+  using ContactRange = IteratorRange<Iterator>;
+
+  explicit LivePhoneBook(PhoneBook::Contacts contacts, PhoneBookOptions options = {});
+  explicit LivePhoneBook(PhoneBook book);
+
+  void Add(Contact contact);
+
+  // Вливает дельту в основную книгу, не дожидаясь её роста
+  void Compact();
+
+  ContactRange FindByNamePrefix(std::string_view name_prefix) const;
+
+  size_t size() const;
+  size_t DeltaSize() const;
+
+private:
+  size_t MaxDeltaSize() const;
+
+  PhoneBook base_;
+  Delta delta_;
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "string_stringview_hash.h"
+#include "string_stringview_equal.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Ограниченный LRU-кэш со строковыми ключами, безопасный для использования из
+// нескольких потоков. Ключи распределяются по шардам, у каждого шарда свой
+// мьютекс и своя LRU-очередь, поэтому потоки, читающие разные ключи, почти не
+// конкурируют между собой. Ёмкость 0 выключает кэш.
+template <class Value>
+class ShardedLruCache {
+public:
+  struct Stats {
+    uint64_t hits, misses;
+    size_t size;
+  };
+
+  explicit ShardedLruCache(size_t capacity, size_t shard_count = 16)
+    : shards_(capacity == 0 ? 0 : std::max<size_t>(1, std::min(shard_count, capacity)))
+  {
+    for (auto& shard : shards_) {
+      shard.capacity = (capacity + shards_.size() - 1) / shards_.size();
+    }
+  }
+
+  std::optional<Value> Find(std::string_view key) {
+    if (shards_.empty()) {
+      misses_.fetch_add(1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+
+    auto& shard = GetShard(key);
+    std::lock_guard lock(shard.mutex);
+    auto found = shard.index.find(key);
+    if (found == shard.index.end()) {
+      misses_.fetch_add(1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    shard.items.splice(shard.items.begin(), shard.items, found->second);
+    return found->second->second;
+  }
+
+  void Put(std::string_view key, Value value) {
+    if (shards_.empty()) {
+      return;
+    }
+
+    auto& shard = GetShard(key);
+    std::lock_guard lock(shard.mutex);
+    if (auto found = shard.index.find(key); found != shard.index.end()) {
+      found->second->second = std::move(value);
+      shard.items.splice(shard.items.begin(), shard.items, found->second);
+      return;
+    }
+    if (shard.items.size() == shard.capacity) {
+      shard.index.erase(shard.items.back().first);
+      shard.items.pop_back();
+    }
+    shard.items.emplace_front(std::string(key), std::move(value));
+    shard.index.emplace(shard.items.front().first, shard.items.begin());
+  }
+
+  Stats GetStats() const {
+    Stats stats{hits_.load(), misses_.load(), 0};
+    for (auto& shard : shards_) {
+      std::lock_guard lock(shard.mutex);
+      stats.size += shard.items.size();
+    }
+    return stats;
+  }
+
+private:
+  using Items = std::list<std::pair<std::string, Value>>;
+
+  struct Shard {
+    mutable std::mutex mutex;
+    size_t capacity = 0;
+    Items items;
+    std::unordered_map<std::string_view, typename Items::iterator,
+                       string_stringview::Hash,
+                       string_stringview::Equal> index;
+  };
+
+  Shard& GetShard(std::string_view key) {
+    return shards_[string_stringview::Hash()(key) % shards_.size()];
+  }
+
+  std::vector<Shard> shards_;
+  std::atomic<uint64_t> hits_ = 0;
+  std::atomic<uint64_t> misses_ = 0;
+};
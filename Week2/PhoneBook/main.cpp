@@ -1,9 +1,17 @@
 #include "phone_book.h"
+#include "flat_phone_book.h"
+#include "live_phone_book.h"
+#include "phone_number.h"
 #include "contact.pb.h"
 
 #include "test_runner.h"
 
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
 #include <sstream>
+#include <thread>
 
 using namespace std;
 
@@ -223,10 +231,708 @@ void TestFindNameByPrefix2() {
   );
 }
 
+void TestPrefixIndex() {
+  PhoneBook::Contacts contacts;
+  for (string name : {"a", "aaaa", "aabc", "aabccc", "aabcbc", "aeca", "aeca", "aefg", "aq", "",
+                      "Ivan Ivanov", "Ivan Petrov", "Ivan", "Vasiliy Petrov", "Vasilisa Kuznetsova"}) {
+    contacts.push_back({name, std::nullopt, {}});
+  }
+  const PhoneBook plain(contacts);
+  const PhoneBook indexed(contacts, {.prefix_index = true});
+
+  auto get_names = [](PhoneBook::ContactRange range) {
+    vector<string> result;
+    for (const auto& record : range) {
+      result.push_back(record.name);
+    }
+    return result;
+  };
+
+  vector<string> prefixes = {"b", "ab", "aaaaa", "aeb", "Ivan Ivanovich", "Vasilisa Kuznetsova!", "\xff"};
+  for (const auto& contact : contacts) {
+    for (size_t length = 0; length <= contact.name.size(); ++length) {
+      prefixes.push_back(contact.name.substr(0, length));
+    }
+  }
+  for (const auto& prefix : prefixes) {
+    ASSERT_EQUAL(get_names(indexed.FindByNamePrefix(prefix)), get_names(plain.FindByNamePrefix(prefix)));
+  }
+
+  const PhoneBook empty({}, {.prefix_index = true});
+  ASSERT_EQUAL(empty.FindByNamePrefix("").size(), 0u);
+  ASSERT_EQUAL(empty.FindByNamePrefix("a").size(), 0u);
+}
+
+void TestEytzingerIndex() {
+  auto get_names = [](PhoneBook::ContactRange range) {
+    vector<string> result;
+    for (const auto& record : range) {
+      result.push_back(record.name);
+    }
+    return result;
+  };
+
+  // Короткий алфавит с нулевым и максимальным байтом, чтобы ключи часто совпадали
+  const string alphabet("ab\0\xff", 4);
+  mt19937 gen(7);
+  for (size_t count : {0, 1, 2, 7, 8, 100, 1000}) {
+    PhoneBook::Contacts contacts;
+    for (size_t i = 0; i < count; ++i) {
+      string name(uniform_int_distribution<size_t>(0, 12)(gen), 'a');
+      for (auto& c : name) {
+        c = alphabet[uniform_int_distribution<size_t>(0, alphabet.size() - 1)(gen)];
+      }
+      contacts.push_back({name, std::nullopt, {}});
+    }
+    const PhoneBook plain(contacts, {.cache_capacity = 0});
+    const PhoneBook indexed(contacts, {.eytzinger_index = true});
+
+    vector<string> prefixes = {"", "c", "abababababab", string(9, '\xff'), string(3, '\0')};
+    for (const auto& contact : contacts) {
+      for (size_t length = 0; length <= contact.name.size(); ++length) {
+        prefixes.push_back(contact.name.substr(0, length));
+      }
+      prefixes.push_back(contact.name + 'b');
+    }
+    for (const auto& prefix : prefixes) {
+      ASSERT_EQUAL(get_names(indexed.FindByNamePrefix(prefix)), get_names(plain.FindByNamePrefix(prefix)));
+    }
+  }
+}
+
+void TestNarrowAndBatch() {
+  const PhoneBook book({
+                           {"Ivan Ivanov", std::nullopt, {}},
+                           {"Ivan Petrov", std::nullopt, {}},
+                           {"Ivanna", std::nullopt, {}},
+                           {"Igor", std::nullopt, {}},
+                           {"Vasiliy Petrov", std::nullopt, {}},
+                           {"", std::nullopt, {}},
+                       });
+
+  auto get_names = [](PhoneBook::ContactRange range) {
+    vector<string> result;
+    for (const auto& record : range) {
+      result.push_back(record.name);
+    }
+    return result;
+  };
+
+  auto range = book.FindByNamePrefix("I");
+  ASSERT_EQUAL(range.size(), 4u);
+  range = book.Narrow(range, "Iv");
+  ASSERT_EQUAL(get_names(range), (vector<string>{"Ivan Ivanov", "Ivan Petrov", "Ivanna"}));
+  range = book.Narrow(range, "Ivan ");
+  ASSERT_EQUAL(get_names(range), (vector<string>{"Ivan Ivanov", "Ivan Petrov"}));
+  ASSERT_EQUAL(book.Narrow(range, "Ivan X").size(), 0u);
+
+  vector<string_view> prefixes = {"Iva", "V", "I", "Ivan P", "", "Iv", "Z", "Ivan", "Vasiliy"};
+  auto results = book.FindByNamePrefixes(prefixes);
+  ASSERT_EQUAL(results.size(), prefixes.size());
+  for (size_t i = 0; i < prefixes.size(); ++i) {
+    ASSERT_EQUAL(get_names(results[i]), get_names(book.FindByNamePrefix(prefixes[i])));
+  }
+  ASSERT(book.FindByNamePrefixes({}).empty());
+}
+
+void TestFoldedNamePrefix() {
+  const PhoneBook book({
+                           {"Ivan Ivanov", std::nullopt, {}},
+                           {"ivan petrov", std::nullopt, {}},
+                           {"IVANNA", std::nullopt, {}},
+                           {"Иван Иванов", std::nullopt, {}},
+                           {"иванов Пётр", std::nullopt, {}},
+                           {"ЁЖИК", std::nullopt, {}},
+                           {"Élodie", std::nullopt, {}},
+                           {"Vasiliy", std::nullopt, {}},
+                       }, {.folded_names = true});
+
+  auto get_names = [](PhoneBook::ContactPtrRange range) {
+    vector<string> result;
+    for (auto contact : range) {
+      result.push_back(contact->name);
+    }
+    return result;
+  };
+
+  ASSERT_EQUAL(get_names(book.FindByFoldedNamePrefix("ivan")), (vector<string>{"Ivan Ivanov", "ivan petrov", "IVANNA"}));
+  ASSERT_EQUAL(get_names(book.FindByFoldedNamePrefix("IVAN ")), (vector<string>{"Ivan Ivanov", "ivan petrov"}));
+  ASSERT_EQUAL(get_names(book.FindByFoldedNamePrefix("ИВАН")), (vector<string>{"Иван Иванов", "иванов Пётр"}));
+  ASSERT_EQUAL(get_names(book.FindByFoldedNamePrefix("иванов п")), (vector<string>{"иванов Пётр"}));
+  ASSERT_EQUAL(get_names(book.FindByFoldedNamePrefix("ёж")), (vector<string>{"ЁЖИК"}));
+  ASSERT_EQUAL(get_names(book.FindByFoldedNamePrefix("éLO")), (vector<string>{"Élodie"}));
+  ASSERT_EQUAL(book.FindByFoldedNamePrefix("").size(), 8u);
+  ASSERT_EQUAL(book.FindByFoldedNamePrefix("x").size(), 0u);
+
+  // Побайтовый поиск по-прежнему учитывает регистр
+  ASSERT_EQUAL(book.FindByNamePrefix("ivan").size(), 1u);
+
+  const PhoneBook plain({{"Ivan", std::nullopt, {}}});
+  ASSERT_EQUAL(plain.FindByFoldedNamePrefix("ivan").size(), 0u);
+}
+
+void TestBoundedCache() {
+  PhoneBook::Contacts contacts;
+  for (char c = 'a'; c <= 'z'; ++c) {
+    contacts.push_back({string(3, c), std::nullopt, {}});
+  }
+  const PhoneBook book(contacts, {.cache_capacity = 4, .cache_shards = 2});
+
+  ASSERT_EQUAL(book.FindByNamePrefix("a").size(), 1u);
+  ASSERT_EQUAL(book.FindByNamePrefix("a").size(), 1u);
+  auto stats = book.GetCacheStats();
+  ASSERT_EQUAL(stats.hits, 1u);
+  ASSERT_EQUAL(stats.misses, 1u);
+
+  for (char c = 'a'; c <= 'z'; ++c) {
+    ASSERT_EQUAL(book.FindByNamePrefix(string(2, c)).size(), 1u);
+  }
+  ASSERT(book.GetCacheStats().size <= 4u);
+
+  const PhoneBook uncached(contacts, {.cache_capacity = 0});
+  ASSERT_EQUAL(uncached.FindByNamePrefix("b").size(), 1u);
+  ASSERT_EQUAL(uncached.GetCacheStats().size, 0u);
+}
+
+void TestConcurrentFind() {
+  PhoneBook::Contacts contacts;
+  for (int i = 0; i < 1000; ++i) {
+    contacts.push_back({to_string(i), std::nullopt, {}});
+  }
+  const PhoneBook book(contacts, {.cache_capacity = 64});
+
+  vector<thread> threads;
+  vector<size_t> found(4);
+  for (size_t t = 0; t < found.size(); ++t) {
+    threads.emplace_back([&book, &result = found[t]] {
+      for (int round = 0; round < 100; ++round) {
+        for (int i = 0; i < 100; ++i) {
+          result += book.FindByNamePrefix(to_string(i)).size();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  // "0" -> 1 имя, "1".."9" -> по 111 имён, "10".."99" -> по 11 имён
+  for (auto count : found) {
+    ASSERT_EQUAL(count, 100u * (1 + 9 * 111 + 90 * 11));
+  }
+  ASSERT(book.GetCacheStats().size <= 64u);
+}
+
+void TestStreamingDeserialization() {
+  PhoneBook::Contacts contacts;
+  for (int i = 0; i < 1000; ++i) {
+    contacts.push_back({"Contact " + to_string(i), Date{1900 + i, 1 + i % 12, 1 + i % 28}, {to_string(i), "+" + to_string(i)}});
+  }
+  const PhoneBook book(contacts);
+
+  ostringstream output(std::ios::binary);
+  book.SaveTo(output);
+  // Неизвестное поле между контактами должно пропускаться
+  output << "\x10\x05";
+  PhoneBookSerialize::ContactList tail;
+  tail.add_contact()->set_name("Контакт последний");
+  tail.SerializeToOstream(&output);
+
+  istringstream input(output.str(), std::ios::binary);
+  const PhoneBook loaded = DeserializePhoneBook(input);
+
+  auto range = loaded.FindByNamePrefix("");
+  ASSERT_EQUAL(range.size(), 1001u);
+  auto expected = book.FindByNamePrefix("");
+  for (size_t i = 0; i < expected.size(); ++i) {
+    const auto& l = range.begin()[i];
+    const auto& r = expected.begin()[i];
+    ASSERT_EQUAL(l.name, r.name);
+    ASSERT_EQUAL(l.phones, r.phones);
+    ASSERT_EQUAL(l.birthday->year, r.birthday->year);
+  }
+  ASSERT_EQUAL(range.begin()[1000].name, "Контакт последний");
+
+  // Поле длиннее блока чтения переносится по частям, а не разбирается заново
+  const size_t largeSize = 40 << 20;
+  string large = "\x7a";
+  size_t length = largeSize;
+  for (; length >= 0x80; length >>= 7) {
+    large += static_cast<char>((length & 0x7f) | 0x80);
+  }
+  large += static_cast<char>(length);
+  large += string(largeSize, 'x');
+  for (size_t threadCount : {1, 4}) {
+    istringstream input(output.str() + large + tail.SerializeAsString(), std::ios::binary);
+    ASSERT_EQUAL(DeserializePhoneBook(input, {.thread_count = threadCount}).FindByNamePrefix("").size(), 1002u);
+  }
+}
+
+void TestCorruptedDeserialization() {
+  const PhoneBook book(PhoneBook::Contacts{{"Ivan Ivanov", std::nullopt, {"112"}}, {"Margarita Petrova", std::nullopt, {}}});
+  ostringstream output(std::ios::binary);
+  book.SaveTo(output);
+  const string saved = output.str();
+
+  for (size_t threadCount : {1, 4}) {
+    istringstream input(saved, std::ios::binary);
+    ASSERT_EQUAL(DeserializePhoneBook(input, {.thread_count = threadCount}).FindByNamePrefix("").size(), 2u);
+  }
+
+  // Оборванный или испорченный поток — ошибка, а не укороченная книга
+  const vector<string> corrupted = {
+      saved + "\x0a",                            // тег без длины
+      saved + "\x0a\x80",                        // оборванная длина
+      saved + string("\x0a\x02\x0a\x05", 4),     // контакт, который не разбирается
+      saved + string("\x0a\x05\x0a\x03", 4),     // оборванный контакт
+      saved + "\x0f",                            // неизвестный тип поля
+      saved + string("\x00\x01", 2),             // нулевой тег
+      "\x0f" + saved,
+  };
+  for (const auto& data : corrupted) {
+    for (size_t threadCount : {1, 4}) {
+      istringstream input(data, std::ios::binary);
+      bool thrown = false;
+      try {
+        DeserializePhoneBook(input, {.thread_count = threadCount});
+      } catch (const runtime_error&) {
+        thrown = true;
+      }
+      ASSERT(thrown);
+    }
+  }
+}
+
+void TestParallelConstruction() {
+  PhoneBook::Contacts contacts;
+  for (int i = 0; i < 100'000; ++i) {
+    contacts.push_back({to_string(i * 7919 % 100'003), std::nullopt, {to_string(i)}});
+  }
+  const PhoneBook sequential(contacts, {.thread_count = 1});
+  const PhoneBook parallel(contacts, {.thread_count = 4});
+
+  auto s = sequential.FindByNamePrefix("");
+  auto p = parallel.FindByNamePrefix("");
+  ASSERT_EQUAL(p.size(), contacts.size());
+  for (size_t i = 0; i < s.size(); ++i) {
+    ASSERT_EQUAL(s.begin()[i].name, p.begin()[i].name);
+  }
+
+  ostringstream sequentialOutput(std::ios::binary), parallelOutput(std::ios::binary);
+  sequential.SaveTo(sequentialOutput);
+  parallel.SaveTo(parallelOutput);
+  ASSERT(sequentialOutput.str() == parallelOutput.str());
+
+  istringstream input(parallelOutput.str(), std::ios::binary);
+  const PhoneBook loaded = DeserializePhoneBook(input, {.thread_count = 4});
+  auto l = loaded.FindByNamePrefix("");
+  ASSERT_EQUAL(l.size(), contacts.size());
+  for (size_t i = 0; i < s.size(); ++i) {
+    ASSERT_EQUAL(s.begin()[i].name, l.begin()[i].name);
+    ASSERT_EQUAL(s.begin()[i].phones, l.begin()[i].phones);
+  }
+}
+
+void TestLivePhoneBook() {
+  LivePhoneBook book({
+                         {"Ivan Ivanov", std::nullopt, {}},
+                         {"Vasiliy Petrov", std::nullopt, {}},
+                         {"Ivan Petrov", std::nullopt, {}},
+                     });
+
+  auto get_names = [](LivePhoneBook::ContactRange range) {
+    vector<string> result;
+    for (const auto& record : range) {
+      result.push_back(record.name);
+    }
+    return result;
+  };
+
+  book.Add({"Ivan Aleksandrov", std::nullopt, {"+7"}});
+  book.Add({"Ivan Petrov", std::nullopt, {"new"}});
+  book.Add({"Anna", std::nullopt, {}});
+  ASSERT_EQUAL(book.DeltaSize(), 3u);
+  ASSERT_EQUAL(book.size(), 6u);
+
+  ASSERT_EQUAL(
+      get_names(book.FindByNamePrefix("Ivan")),
+      (vector<string>{"Ivan Aleksandrov", "Ivan Ivanov", "Ivan Petrov", "Ivan Petrov"})
+  );
+  ASSERT_EQUAL(book.FindByNamePrefix("Ivan").size(), 4u);
+  ASSERT(book.FindByNamePrefix("Ivan Petrov").begin()->phones.empty());
+  ASSERT_EQUAL(
+      get_names(book.FindByNamePrefix("")),
+      (vector<string>{"Anna", "Ivan Aleksandrov", "Ivan Ivanov", "Ivan Petrov", "Ivan Petrov", "Vasiliy Petrov"})
+  );
+  ASSERT_EQUAL(book.FindByNamePrefix("Z").size(), 0u);
+
+  book.Compact();
+  ASSERT_EQUAL(book.DeltaSize(), 0u);
+  ASSERT_EQUAL(
+      get_names(book.FindByNamePrefix("")),
+      (vector<string>{"Anna", "Ivan Aleksandrov", "Ivan Ivanov", "Ivan Petrov", "Ivan Petrov", "Vasiliy Petrov"})
+  );
+
+  for (int i = 0; i < 10'000; ++i) {
+    book.Add({to_string(i * 7919 % 10'007), std::nullopt, {}});
+  }
+  ASSERT(book.DeltaSize() < 10'000u);
+  ASSERT_EQUAL(book.size(), 10'006u);
+  auto all = get_names(book.FindByNamePrefix(""));
+  ASSERT_EQUAL(all.size(), 10'006u);
+  ASSERT(is_sorted(all.begin(), all.end()));
+  ASSERT_EQUAL(book.FindByNamePrefix("9999").size(), 1u);
+}
+
+void TestFindByPhone() {
+  PhoneBook::Contacts contacts = {
+      {"Ivan Ivanov", std::nullopt, {"+7 (985) 068-55-21", "112"}},
+      {"Margarita Petrova", std::nullopt, {"+79998887766", "+71112223344"}},
+      {"Office", std::nullopt, {"+7-985-068-55-21"}},
+      {"Long One", std::nullopt, {"1234567890123456789"}},
+      {"Long Two", std::nullopt, {"1234567890123456000"}},
+      {"No Phones", std::nullopt, {}},
+  };
+
+  auto get_names = [](const vector<const Contact*>& found) {
+    vector<string> result;
+    for (auto contact : found) {
+      result.push_back(contact->name);
+    }
+    return result;
+  };
+
+  for (bool phoneIndex : {false, true}) {
+    const PhoneBook book(contacts, {.phone_index = phoneIndex});
+    ASSERT_EQUAL(get_names(book.FindByPhone("+79850685521")), (vector<string>{"Ivan Ivanov", "Office"}));
+    ASSERT_EQUAL(get_names(book.FindByPhone("71112223344")), (vector<string>{"Margarita Petrova"}));
+    ASSERT_EQUAL(get_names(book.FindByPhone("112")), (vector<string>{"Ivan Ivanov"}));
+    ASSERT_EQUAL(get_names(book.FindByPhone("1234567890123456789")), (vector<string>{"Long One"}));
+    ASSERT(book.FindByPhone("1234567890123456").empty());
+    ASSERT(book.FindByPhone("7985068552").empty());
+    ASSERT(book.FindByPhone("").empty());
+  }
+
+  const PhoneBook book(contacts, {.phone_index = true});
+  ostringstream output(std::ios::binary);
+  book.SaveTo(output);
+
+  PhoneBookSerialize::ContactList list;
+  ASSERT(list.ParseFromString(output.str()));
+  ASSERT_EQUAL(list.contact_size(), 6);
+  ASSERT_EQUAL(list.phone_index().key_size(), 7);
+
+  for (size_t threadCount : {1, 4}) {
+    istringstream input(output.str(), std::ios::binary);
+    const PhoneBook loaded = DeserializePhoneBook(input, {.phone_index = true, .thread_count = threadCount});
+    ASSERT_EQUAL(get_names(loaded.FindByPhone("8 985 068 55 21")), (vector<string>{}));
+    ASSERT_EQUAL(get_names(loaded.FindByPhone("+7 985 068 55 21")), (vector<string>{"Ivan Ivanov", "Office"}));
+    ASSERT_EQUAL(loaded.FindByNamePrefix("").size(), 6u);
+  }
+
+  // Устаревший или испорченный индекс не принимается, а строится заново
+  auto corrupt = [&](auto change) {
+    auto copy = list;
+    change(*copy.mutable_phone_index());
+    istringstream input(copy.SerializeAsString(), std::ios::binary);
+    const PhoneBook loaded = DeserializePhoneBook(input, {.phone_index = true});
+    ASSERT_EQUAL(get_names(loaded.FindByPhone("+7 985 068 55 21")), (vector<string>{"Ivan Ivanov", "Office"}));
+    ASSERT_EQUAL(get_names(loaded.FindByPhone("71112223344")), (vector<string>{"Margarita Petrova"}));
+  };
+  corrupt([](auto& index) {
+    for (auto& key : *index.mutable_key()) {
+      key ^= 1;
+    }
+  });
+  corrupt([](auto& index) {
+    index.mutable_key()->SwapElements(0, 6);
+    index.mutable_contact()->SwapElements(0, 6);
+    index.mutable_phone()->SwapElements(0, 6);
+  });
+  corrupt([](auto& index) {
+    index.set_contact(1, index.contact(0));
+    index.set_phone(1, index.phone(0));
+    index.set_key(1, index.key(0));
+  });
+}
+
+void TestFindByBirthday() {
+  PhoneBook::Contacts contacts = {
+      {"Ivan Ivanov", Date{1980, 1, 13}, {}},
+      {"Margarita Petrova", Date{1989, 4, 23}, {}},
+      {"Anna", Date{2001, 4, 23}, {}},
+      {"New Year", Date{1999, 12, 31}, {}},
+      {"Leap", Date{2000, 2, 29}, {}},
+      {"First", Date{1970, 1, 1}, {}},
+      {"No Birthday", std::nullopt, {"+7-4862-77-25-64"}},
+  };
+
+  auto get_names = [](const vector<const Contact*>& found) {
+    vector<string> result;
+    for (auto contact : found) {
+      result.push_back(contact->name);
+    }
+    return result;
+  };
+
+  for (bool birthdayIndex : {false, true}) {
+    const PhoneBook book(contacts, {.birthday_index = birthdayIndex});
+    ASSERT_EQUAL(get_names(book.FindByBirthday({4, 23}, {4, 23})), (vector<string>{"Anna", "Margarita Petrova"}));
+    ASSERT_EQUAL(get_names(book.FindByBirthday({1, 2}, {3, 1})), (vector<string>{"Ivan Ivanov", "Leap"}));
+    ASSERT_EQUAL(get_names(book.FindByBirthday({12, 1}, {1, 13})), (vector<string>{"New Year", "First", "Ivan Ivanov"}));
+    ASSERT_EQUAL(get_names(book.FindByBirthday({5, 1}, {12, 30})), (vector<string>{}));
+    ASSERT_EQUAL(book.FindByBirthday({1, 1}, {12, 31}).size(), 6u);
+  }
+
+  const PhoneBook book(contacts, {.birthday_index = true});
+  ostringstream output(std::ios::binary);
+  book.SaveTo(output);
+
+  PhoneBookSerialize::ContactList list;
+  ASSERT(list.ParseFromString(output.str()));
+  ASSERT_EQUAL(list.contact_size(), 7);
+  ASSERT_EQUAL(list.birthday_index_size(), 6);
+
+  for (size_t threadCount : {1, 4}) {
+    istringstream input(output.str(), std::ios::binary);
+    const PhoneBook loaded = DeserializePhoneBook(input, {.birthday_index = true, .thread_count = threadCount});
+    ASSERT_EQUAL(get_names(loaded.FindByBirthday({12, 31}, {1, 1})), (vector<string>{"New Year", "First"}));
+  }
+
+  // Несогласованный сохранённый индекс строится заново
+  list.set_birthday_index(0, list.birthday_index(1));
+  istringstream input(list.SerializeAsString(), std::ios::binary);
+  const PhoneBook loaded = DeserializePhoneBook(input, {.birthday_index = true});
+  ASSERT_EQUAL(get_names(loaded.FindByBirthday({4, 23}, {4, 23})), (vector<string>{"Anna", "Margarita Petrova"}));
+  ASSERT_EQUAL(loaded.FindByBirthday({1, 1}, {12, 31}).size(), 6u);
+}
+
+void TestFlatPhoneBook() {
+  const PhoneBook book({
+                           {"Ivan Ivanov", Date{1980, 1, 13}, {"+79850685521"}},
+                           {"Margarita Petrova", Date{1989, 4, 23}, {"+79998887766", "+71112223344"}},
+                           {"Just Birthday", Date{1989, 4, 23}, {}},
+                           {"No Birthday", std::nullopt, {"+7-4862-77-25-64"}},
+                           {"Ivan Petrov", std::nullopt, {}},
+                       });
+
+  auto path = filesystem::temp_directory_path() / "phone_book_test.flat";
+  {
+    ofstream output(path, ios::binary);
+    SaveFlatPhoneBook(book, output);
+  }
+  const auto flat = FlatPhoneBook::Map(path);
+  filesystem::remove(path);
+
+  ASSERT_EQUAL(flat.size(), 5u);
+  auto expected = book.FindByNamePrefix("");
+  for (size_t i = 0; i < flat.size(); ++i) {
+    const auto& contact = expected.begin()[i];
+    auto view = flat[i];
+    ASSERT_EQUAL(string(view.Name()), contact.name);
+    ASSERT_EQUAL(bool(view.Birthday()), bool(contact.birthday));
+    if (contact.birthday) {
+      ASSERT_EQUAL(view.Birthday()->year, contact.birthday->year);
+      ASSERT_EQUAL(view.Birthday()->month, contact.birthday->month);
+      ASSERT_EQUAL(view.Birthday()->day, contact.birthday->day);
+    }
+    vector<string> phones;
+    for (size_t j = 0; j < view.PhoneCount(); ++j) {
+      phones.emplace_back(view.Phone(j));
+    }
+    ASSERT_EQUAL(phones, contact.phones);
+  }
+
+  auto get_names = [](FlatPhoneBook::ContactRange range) {
+    vector<string> result;
+    for (auto view : range) {
+      result.emplace_back(view.Name());
+    }
+    return result;
+  };
+  ASSERT_EQUAL(get_names(flat.FindByNamePrefix("Ivan")), (vector<string>{"Ivan Ivanov", "Ivan Petrov"}));
+  ASSERT_EQUAL(get_names(flat.FindByNamePrefix("M")), (vector<string>{"Margarita Petrova"}));
+  ASSERT_EQUAL(flat.FindByNamePrefix("").size(), 5u);
+  ASSERT_EQUAL(flat.FindByNamePrefix("Z").size(), 0u);
+  ASSERT_EQUAL(flat.FindByNamePrefix("Ivan Ivanovich").size(), 0u);
+
+  static_assert(random_access_iterator<FlatPhoneBook::Iterator>);
+  auto all = flat.FindByNamePrefix("");
+  ASSERT_EQUAL(string((*(1 + all.begin())).Name()), "Ivan Petrov");
+}
+
+void TestCompactStorage() {
+  PhoneBook::Contacts contacts = {
+      {"Vasiliy Petrov", std::nullopt, {"+7 999 123-45-67", "112"}},
+      {"Ivan Ivanov", Date{1980, 1, 13}, {}},
+      {"Ivan Petrov", std::nullopt, {"+79850685521"}},
+  };
+  const PhoneBook book(contacts);
+  const auto compact = FlatPhoneBook::Build(contacts);
+
+  ASSERT_EQUAL(compact.size(), 3u);
+  auto expected = book.FindByNamePrefix("");
+  auto actual = compact.FindByNamePrefix("");
+  auto it = actual.begin();
+  for (const auto& contact : expected) {
+    auto view = *it++;
+    ASSERT_EQUAL(string(view.Name()), contact.name);
+    ASSERT_EQUAL(view.PhoneCount(), contact.phones.size());
+    for (size_t i = 0; i < contact.phones.size(); ++i) {
+      ASSERT_EQUAL(string(view.Phone(i)), contact.phones[i]);
+    }
+  }
+  ASSERT_EQUAL(compact.FindByNamePrefix("Ivan").size(), 2u);
+  ASSERT_EQUAL(compact[0].Birthday()->year, 1980);
+
+  const auto copy = compact;
+  ASSERT_EQUAL(string(copy[2].Phone(1)), "112");
+  ASSERT(compact.ByteSize() > 0u);
+}
+
+void TestPackedPhones() {
+  vector<string> phones = {
+      "+79850685521", "+7-4862-77-25-64", "325-87-16", "112", "+7 (999) 123-45-67 доб. 4",
+      "", "нет номера", string("12\0" "34", 5), "+79998887766",
+  };
+
+  PhoneNumber::TemplateTable templates;
+  string packed;
+  vector<size_t> offsets = {0};
+  for (const auto& phone : phones) {
+    templates.Encode(phone, packed);
+    offsets.push_back(packed.size());
+  }
+  // "+79850685521" и "+79998887766" используют один шаблон, номер с '\0' хранится
+  // как есть, а нулевой идентификатор зарезервирован под RawTemplateId
+  ASSERT_EQUAL(templates.Templates().size(), 8u);
+
+  for (size_t i = 0; i < phones.size(); ++i) {
+    string_view encoded(packed.data() + offsets[i], offsets[i + 1] - offsets[i]);
+    auto decoded = PhoneNumber::Decode(encoded, [&](uint32_t id) -> string_view {
+      return templates.Templates()[id];
+    });
+    ASSERT_EQUAL(decoded, phones[i]);
+    ASSERT_EQUAL(PhoneNumber::DecodeDigits(encoded), PhoneNumber::Digits(phones[i]));
+  }
+  ASSERT_EQUAL(offsets[1] - offsets[0], 1u + 6u);
+
+  const auto book = FlatPhoneBook::Build(PhoneBook::Contacts{{"A", std::nullopt, phones}});
+  ASSERT_EQUAL(book[0].PhoneCount(), phones.size());
+  for (size_t i = 0; i < phones.size(); ++i) {
+    ASSERT_EQUAL(book[0].Phone(i), phones[i]);
+  }
+  ASSERT_EQUAL(book[0].PhoneDigits(1), "74862772564");
+
+  // Идентификатор шаблона длиннее пяти байт, с лишними битами или оборванный
+  for (string_view corrupted : {"\xff\xff\xff\xff\xff\x01", "\x80\x80\x80\x80\x7f", "\x80", ""}) {
+    bool thrown = false;
+    try {
+      PhoneNumber::DecodeDigits(corrupted);
+    } catch (const runtime_error&) {
+      thrown = true;
+    }
+    ASSERT(thrown);
+  }
+}
+
+void TestFlatPhoneBookRejectsGarbage() {
+  auto path = filesystem::temp_directory_path() / "phone_book_garbage.flat";
+  {
+    ofstream output(path, ios::binary);
+    output << "definitely not a phone book, but long enough to hold a header";
+  }
+  bool thrown = false;
+  try {
+    FlatPhoneBook::Map(path);
+  } catch (const runtime_error&) {
+    thrown = true;
+  }
+  filesystem::remove(path);
+  ASSERT(thrown);
+
+  // Настоящий образ с испорченным заголовком или таблицами тоже отвергается
+  PhoneBook::Contacts contacts = {
+      {"Ivan Ivanov", std::nullopt, {"+7-495-111-22-33", "112"}},
+      {"Margarita Petrova", Date{1989, 4, 23}, {"8 (800) 555-35-35"}},
+  };
+  ostringstream image(std::ios::binary);
+  SaveFlatPhoneBook(PhoneBook(contacts, PhoneBookOptions{}), image);
+  auto field = [&image](size_t offset) {
+    uint64_t value;
+    memcpy(&value, image.str().data() + offset, sizeof(value));
+    return value;
+  };
+  // Map проверяет только заголовок; испорченную запись находит Validate или
+  // обращение к ней
+  auto rejects = [&](size_t offset, auto value, auto touch) {
+    string data = image.str();
+    memcpy(data.data() + offset, &value, sizeof(value));
+    {
+      ofstream output(path, ios::binary);
+      output << data;
+    }
+    bool rejected = false;
+    try {
+      touch(FlatPhoneBook::Map(path));
+    } catch (const runtime_error&) {
+      rejected = true;
+    }
+    filesystem::remove(path);
+    return rejected;
+  };
+  auto map = [](const FlatPhoneBook&) {};
+  auto validate = [](const FlatPhoneBook& book) {
+    book.Validate();
+  };
+  auto readAll = [](const FlatPhoneBook& book) {
+    for (size_t i = 0; i < book.size(); ++i) {
+      book[i].Name();
+      for (size_t phone = 0; phone < book[i].PhoneCount(); ++phone) {
+        book[i].Phone(phone);
+      }
+    }
+  };
+  // Поля заголовка: contact_count по смещению 16, template_count — 32, names_size — 40
+  ASSERT(!rejects(16, field(16), validate));
+  ASSERT(!rejects(16, field(16), readAll));
+  // contact_count, при котором размеры секций переполняются и оказываются меньше файла
+  ASSERT(rejects(16, UINT64_MAX / 8, map));
+  ASSERT(rejects(16, UINT64_MAX / 20 + 1, map));
+  // Смещение первого имени больше следующего
+  ASSERT(!rejects(64 + 8, uint64_t(1000), map));
+  ASSERT(rejects(64 + 8, uint64_t(1000), validate));
+  ASSERT(rejects(64 + 8, uint64_t(1000), readAll));
+  // Первый номер ссылается на несуществующий шаблон: его varint — первый байт
+  // секции телефонов, которая идёт за выровненными именами
+  auto templateCount = field(32);
+  size_t names = 152 + (templateCount + 1) * 8;
+  size_t phones = names + ((field(40) + 7) & ~uint64_t(7));
+  ASSERT(!rejects(phones, static_cast<uint8_t>(0x7F), map));
+  ASSERT(rejects(phones, static_cast<uint8_t>(0x7F), validate));
+  ASSERT(rejects(phones, static_cast<uint8_t>(0x7F), readAll));
+}
+
 int main() {
   TestRunner tr;
   RUN_TEST(tr, TestFindNameByPrefix);
   RUN_TEST(tr, TestFindNameByPrefix2);
+  RUN_TEST(tr, TestPrefixIndex);
+  RUN_TEST(tr, TestEytzingerIndex);
+  RUN_TEST(tr, TestNarrowAndBatch);
+  RUN_TEST(tr, TestFoldedNamePrefix);
+  RUN_TEST(tr, TestBoundedCache);
+  RUN_TEST(tr, TestConcurrentFind);
   RUN_TEST(tr, TestSerialization);
   RUN_TEST(tr, TestDeserialization);
+  RUN_TEST(tr, TestStreamingDeserialization);
+  RUN_TEST(tr, TestCorruptedDeserialization);
+  RUN_TEST(tr, TestParallelConstruction);
+  RUN_TEST(tr, TestLivePhoneBook);
+  RUN_TEST(tr, TestFindByPhone);
+  RUN_TEST(tr, TestFindByBirthday);
+  RUN_TEST(tr, TestFlatPhoneBook);
+  RUN_TEST(tr, TestCompactStorage);
+  RUN_TEST(tr, TestPackedPhones);
+  RUN_TEST(tr, TestFlatPhoneBookRejectsGarbage);
 }
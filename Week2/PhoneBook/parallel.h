@@ -0,0 +1,29 @@
+#pragma once
+
+#include <algorithm>
+#include <future>
+#include <vector>
+
+// Делит [0, count) на не более чем thread_count непрерывных частей и вызывает
+// func(begin, end) для каждой из них в отдельном потоке. Первая часть выполняется
+// в вызывающем потоке, исключения из остальных пробрасываются наружу.
+template <class Func>
+void ParallelFor(size_t count, size_t thread_count, Func func) {
+  size_t parts = std::min(count, std::max<size_t>(thread_count, 1));
+  if (parts <= 1) {
+    if (count > 0) {
+      func(size_t(0), count);
+    }
+    return;
+  }
+
+  std::vector<std::future<void>> futures;
+  futures.reserve(parts - 1);
+  for (size_t part = 1; part < parts; ++part) {
+    futures.push_back(std::async(std::launch::async, func, count * part / parts, count * (part + 1) / parts));
+  }
+  func(size_t(0), count / parts);
+  for (auto& future : futures) {
+    future.get();
+  }
+}
@@ -1,44 +1,153 @@
 #include "phone_book.h"
 
+#include "case_folding.h"
 #include "contact.pb.h"
+#include "parallel.h"
+#include "phone_number.h"
+
+#include <limits>
+#include <ranges>
+#include <stdexcept>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+#include <google/protobuf/wire_format_lite.h>
 
 using namespace std;
 using Contacts = PhoneBook::Contacts;
 using ContactRange = PhoneBook::ContactRange;
 
-struct ContactNameCompare {
-  typedef void is_transparent;
-  bool operator()(const Contact &contact, string_view name) const {
-    string_view cname(contact.name.c_str(), min(name.size(), contact.name.size()));
-    return cname < name;
-  }
-  bool operator()(string_view name, const Contact &contact) const {
-    string_view cname(contact.name.c_str(), min(name.size(), contact.name.size()));
-    return name < cname;
-  }
-};
-
-Contacts SortContacts(Contacts contacts) {
-  std::sort(begin(contacts),
-            end(contacts),
-            [](const Contact &l,const Contact &r) {
-                return l.name < r.name;
-              }
-            );
+// Меньше этого размера сортировка и сериализация выполняются в одном потоке
+constexpr size_t ParallelThreshold = 1 << 15;
+// Сколько контактов сериализуется одним куском в SaveTo
+constexpr size_t SaveChunkSize = 1 << 14;
+// Сколько байт за раз читает параллельный DeserializePhoneBook: блоки растут
+// вдвое от первого до последнего, чтобы маленькая книга не платила за большой буфер
+constexpr size_t FirstLoadBlockSize = 1 << 16;
+constexpr size_t LoadBlockSize = 16 << 20;
+
+Contacts SortContacts(Contacts contacts, size_t threadCount) {
+  auto nameLess = [](const Contact &l,const Contact &r) {
+    return l.name < r.name;
+  };
+  if (threadCount <= 1 || contacts.size() < ParallelThreshold) {
+    std::sort(begin(contacts), end(contacts), nameLess);
+    return contacts;
+  }
+
+  // Сортируем куски параллельно, затем сливаем их попарно, тоже параллельно
+  vector<Contacts::iterator> bounds;
+  for (size_t i = 0; i <= threadCount; ++i) {
+    bounds.push_back(begin(contacts) + contacts.size() * i / threadCount);
+  }
+  ParallelFor(threadCount, threadCount, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      std::sort(bounds[i], bounds[i + 1], nameLess);
+    }
+  });
+  for (size_t width = 1; width < threadCount; width *= 2) {
+    size_t mergeCount = (threadCount + 2 * width - 1) / (2 * width);
+    ParallelFor(mergeCount, threadCount, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        size_t left = i * 2 * width;
+        size_t middle = min(left + width, threadCount);
+        size_t right = min(left + 2 * width, threadCount);
+        inplace_merge(bounds[left], bounds[middle], bounds[right], nameLess);
+      }
+    });
+  }
   return contacts;
 }
 
-PhoneBook::PhoneBook(Contacts sorted_contacts, int)
-  : sorted_contacts_(move(sorted_contacts))
-{}
+namespace {
+  MonthDay BirthdayKey(const Contact& contact) {
+    return {contact.birthday->month, contact.birthday->day};
+  }
+}
+
+PhoneBook::PhoneBook(Contacts sorted_contacts, int, PhoneBookOptions options, PersistedIndices indices)
+  : options_(options)
+  , sorted_contacts_(move(sorted_contacts))
+  , phone_index_(move(indices.phones))
+  , birthday_index_(move(indices.birthdays))
+  , cache_(make_unique<ShardedLruCache<ContactRange>>(options.cache_capacity, options.cache_shards))
+{
+  BuildIndices();
+}
+
+PhoneBook::PhoneBook(Contacts contacts, PhoneBookOptions options)
+  : options_(options)
+  , sorted_contacts_(SortContacts(move(contacts), options.thread_count))
+  , cache_(make_unique<ShardedLruCache<ContactRange>>(options.cache_capacity, options.cache_shards))
+{
+  BuildIndices();
+}
+
+void PhoneBook::BuildIndices() {
+  if (options_.prefix_index) {
+    prefix_index_ = PrefixIndex(sorted_contacts_.size(), [this](size_t i) -> string_view {
+      return sorted_contacts_[i].name;
+    });
+  }
+
+  if (options_.eytzinger_index && !options_.prefix_index) {
+    eytzinger_index_ = EytzingerIndex(sorted_contacts_.size(), [this](size_t i) -> string_view {
+      return sorted_contacts_[i].name;
+    });
+  }
+
+  if (options_.folded_names) {
+    BuildFoldedNames();
+  }
+
+  if (options_.birthday_index) {
+    BuildBirthdayIndex();
+  } else {
+    birthday_index_.clear();
+  }
+
+  if (options_.phone_index) {
+    size_t phoneCount = 0;
+    for (const auto& contact : sorted_contacts_) {
+      phoneCount += contact.phones.size();
+    }
+    // Сохранённый индекс уже проверен при загрузке
+    if (phone_index_.size() == phoneCount) {
+      return;
+    }
 
-PhoneBook::PhoneBook(Contacts contacts)
-  : sorted_contacts_(SortContacts(move(contacts)))
-{}
+    phone_index_.clear();
+    phone_index_.reserve(phoneCount);
+    for (size_t i = 0; i < sorted_contacts_.size(); ++i) {
+      const auto& phones = sorted_contacts_[i].phones;
+      for (size_t j = 0; j < phones.size(); ++j) {
+        phone_index_.push_back({PhoneNumber::Key(PhoneNumber::Digits(phones[j])),
+                                static_cast<uint32_t>(i), static_cast<uint32_t>(j)});
+      }
+    }
+    std::sort(phone_index_.begin(), phone_index_.end());
+  } else {
+    phone_index_.clear();
+  }
+}
 
 ContactRange PhoneBook::FindByNamePrefix(string_view name_prefix) const {
-  if (auto found = cache_.find(name_prefix); found != cache_.end()) {
-    return found->second;
+  if (options_.prefix_index) {
+    auto [first, last] = prefix_index_.Find(name_prefix, [this](size_t i) -> string_view {
+      return sorted_contacts_[i].name;
+    });
+    return ContactRange(sorted_contacts_.begin() + first, sorted_contacts_.begin() + last);
+  }
+
+  if (options_.eytzinger_index) {
+    auto [first, last] = eytzinger_index_.Find(name_prefix, [this](size_t i) -> string_view {
+      return sorted_contacts_[i].name;
+    });
+    return ContactRange(sorted_contacts_.begin() + first, sorted_contacts_.begin() + last);
+  }
+
+  if (auto found = cache_->Find(name_prefix)) {
+    return *found;
   }
 
   auto [first, last] = equal_range(
@@ -48,39 +157,313 @@ ContactRange PhoneBook::FindByNamePrefix(string_view name_prefix) const {
     ContactNameCompare()
   );
 
-  return cache_.emplace(string(name_prefix), ContactRange(first, last)).first->second;
+  ContactRange range(first, last);
+  cache_->Put(name_prefix, range);
+  return range;
 }
 
-void PhoneBook::SaveTo(ostream& output) const {
-  PhoneBookSerialize::ContactList contactList;
+ContactRange PhoneBook::Narrow(ContactRange range, string_view longer_prefix) const {
+  auto [first, last] = equal_range(range.begin(), range.end(), longer_prefix, ContactNameCompare());
+  return ContactRange(first, last);
+}
+
+vector<ContactRange> PhoneBook::FindByNamePrefixes(span<const string_view> name_prefixes) const {
+  vector<size_t> order(name_prefixes.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  sort(order.begin(), order.end(), [&](size_t l, size_t r) {
+    return name_prefixes[l] < name_prefixes[r];
+  });
+
+  vector<ContactRange> result(name_prefixes.size(), ContactRange(sorted_contacts_.end(), sorted_contacts_.end()));
+  // Цепочка уже найденных префиксов, каждый следующий продолжает предыдущий
+  vector<size_t> chain;
+  for (size_t i : order) {
+    auto prefix = name_prefixes[i];
+    while (!chain.empty() && !prefix.starts_with(name_prefixes[chain.back()])) {
+      chain.pop_back();
+    }
+    result[i] = chain.empty() ? FindByNamePrefix(prefix) : Narrow(result[chain.back()], prefix);
+    chain.push_back(i);
+  }
+  return result;
+}
 
-  for (auto& sContact : sorted_contacts_) {
-    auto& contact = *contactList.add_contact();
-    contact.set_name(sContact.name);
-    if (sContact.birthday) {
-      auto& birthday = *contact.mutable_birthday();
-      birthday.set_year(sContact.birthday->year);
-      birthday.set_month(sContact.birthday->month);
-      birthday.set_day(sContact.birthday->day);
+PhoneBook::CacheStats PhoneBook::GetCacheStats() const {
+  return cache_->GetStats();
+}
+
+void PhoneBook::BuildBirthdayIndex() {
+  size_t birthdayCount = 0;
+  for (const auto& contact : sorted_contacts_) {
+    birthdayCount += contact.birthday.has_value();
+  }
+  // Сохранённый индекс уже проверен при загрузке
+  if (birthday_index_.size() == birthdayCount) {
+    return;
+  }
+
+  birthday_index_.clear();
+  birthday_index_.reserve(birthdayCount);
+  for (size_t i = 0; i < sorted_contacts_.size(); ++i) {
+    if (sorted_contacts_[i].birthday) {
+      birthday_index_.push_back(static_cast<uint32_t>(i));
     }
-    for (auto& phone : sContact.phones) {
-      contact.mutable_phone_number()->Add(string(phone));
+  }
+  // Стабильно, чтобы в один день контакты шли по именам
+  stable_sort(birthday_index_.begin(), birthday_index_.end(), [this](uint32_t l, uint32_t r) {
+    return BirthdayKey(sorted_contacts_[l]) < BirthdayKey(sorted_contacts_[r]);
+  });
+}
+
+void PhoneBook::BuildFoldedNames() {
+  vector<string> keys(sorted_contacts_.size());
+  ParallelFor(keys.size(), options_.thread_count, [&](size_t first, size_t last) {
+    for (size_t i = first; i < last; ++i) {
+      keys[i] = FoldCase(sorted_contacts_[i].name);
     }
+  });
+
+  vector<uint32_t> order(keys.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    order[i] = static_cast<uint32_t>(i);
   }
+  // Стабильно, чтобы при равных ключах сохранялся порядок имён
+  stable_sort(order.begin(), order.end(), [&keys](uint32_t l, uint32_t r) {
+    return keys[l] < keys[r];
+  });
 
-  contactList.SerializePartialToOstream(&output);
+  size_t poolSize = 0;
+  for (const auto& key : keys) {
+    poolSize += key.size();
+  }
+  folded_names_.clear();
+  folded_names_.reserve(poolSize);
+  folded_offsets_.assign(1, 0);
+  folded_offsets_.reserve(order.size() + 1);
+  folded_contacts_.clear();
+  folded_contacts_.reserve(order.size());
+  for (auto i : order) {
+    folded_names_ += keys[i];
+    folded_offsets_.push_back(folded_names_.size());
+    folded_contacts_.push_back(&sorted_contacts_[i]);
+  }
 }
 
-PhoneBook DeserializePhoneBook(istream& input) {
-  PhoneBookSerialize::ContactList contactList;
-  contactList.ParseFromIstream(&input);
+PhoneBook::ContactPtrRange PhoneBook::FindByFoldedNamePrefix(string_view name_prefix) const {
+  if (folded_contacts_.empty()) {
+    return ContactPtrRange(folded_contacts_.end(), folded_contacts_.end());
+  }
+
+  auto key = FoldCase(name_prefix);
+  auto keyAt = [this, size = key.size()](size_t i) {
+    auto length = min<size_t>(folded_offsets_[i + 1] - folded_offsets_[i], size);
+    return string_view(folded_names_.data() + folded_offsets_[i], length);
+  };
+  // Ключи обрезаются до длины префикса, как в ContactNameCompare
+  auto found = ranges::equal_range(views::iota(size_t(0), folded_contacts_.size()), string_view(key), {}, keyAt);
+  return ContactPtrRange(folded_contacts_.begin() + *found.begin(), folded_contacts_.begin() + *found.end());
+}
 
-  Contacts sortedContacts;
-  sortedContacts.reserve(contactList.contact_size());
+vector<const Contact*> PhoneBook::FindByPhone(string_view phone) const {
+  vector<const Contact*> result;
+  auto digits = PhoneNumber::Digits(phone);
+  if (digits.empty()) {
+    return result;
+  }
+  auto matches = [&digits](const string& candidate) {
+    return PhoneNumber::Digits(candidate) == digits;
+  };
+
+  if (!options_.phone_index) {
+    for (const auto& contact : sorted_contacts_) {
+      if (any_of(contact.phones.begin(), contact.phones.end(), matches)) {
+        result.push_back(&contact);
+      }
+    }
+    return result;
+  }
+
+  auto key = PhoneNumber::Key(digits);
+  auto first = lower_bound(phone_index_.begin(), phone_index_.end(), PhoneIndexEntry{key, 0, 0});
+  for (auto it = first; it != phone_index_.end() && it->key == key; ++it) {
+    const auto& contact = sorted_contacts_[it->contact];
+    // Ключ однозначен только для номеров короче KeyDigits цифр
+    if (digits.size() >= PhoneNumber::KeyDigits && !matches(contact.phones[it->phone])) {
+      continue;
+    }
+    if (result.empty() || result.back() != &contact) {
+      result.push_back(&contact);
+    }
+  }
+  return result;
+}
 
-  for (auto& contact : contactList.contact()) {
-    auto& sContact = sortedContacts.emplace_back();
-    sContact.name = contact.name();
+vector<const Contact*> PhoneBook::FindByBirthday(MonthDay from, MonthDay to) const {
+  vector<const Contact*> result;
+  auto inWindow = [&](MonthDay date) {
+    return from <= to ? from <= date && date <= to : from <= date || date <= to;
+  };
+
+  if (!options_.birthday_index) {
+    for (const auto& contact : sorted_contacts_) {
+      if (contact.birthday && inWindow(BirthdayKey(contact))) {
+        result.push_back(&contact);
+      }
+    }
+    stable_sort(result.begin(), result.end(), [&](const Contact* l, const Contact* r) {
+      auto lKey = BirthdayKey(*l), rKey = BirthdayKey(*r);
+      // Даты после from идут раньше дат, перешедших через конец года
+      return pair(lKey < from, lKey) < pair(rKey < from, rKey);
+    });
+    return result;
+  }
+
+  auto keyAt = [this](uint32_t i) {
+    return BirthdayKey(sorted_contacts_[i]);
+  };
+  auto append = [&](auto first, auto last) {
+    for (auto it = first; it != last; ++it) {
+      result.push_back(&sorted_contacts_[*it]);
+    }
+  };
+  auto first = ranges::lower_bound(birthday_index_, from, {}, keyAt);
+  auto last = ranges::upper_bound(birthday_index_, to, {}, keyAt);
+  if (from <= to) {
+    append(first, max(first, last));
+  } else {
+    append(first, birthday_index_.end());
+    append(birthday_index_.begin(), last);
+  }
+  return result;
+}
+
+namespace {
+  string SerializeContacts(ContactRange contacts) {
+    PhoneBookSerialize::ContactList contactList;
+
+    for (auto& sContact : contacts) {
+      auto& contact = *contactList.add_contact();
+      contact.set_name(sContact.name);
+      if (sContact.birthday) {
+        auto& birthday = *contact.mutable_birthday();
+        birthday.set_year(sContact.birthday->year);
+        birthday.set_month(sContact.birthday->month);
+        birthday.set_day(sContact.birthday->day);
+      }
+      for (auto& phone : sContact.phones) {
+        contact.mutable_phone_number()->Add(string(phone));
+      }
+    }
+
+    return contactList.SerializePartialAsString();
+  }
+}
+
+void PhoneBook::SaveTo(ostream& output) const {
+  // Склеенные сериализованные ContactList разбираются как один ContactList, поэтому
+  // куски можно кодировать параллельно и писать по порядку. Одновременно в памяти
+  // находится не больше thread_count кусков.
+  size_t chunkCount = (sorted_contacts_.size() + SaveChunkSize - 1) / SaveChunkSize;
+  size_t waveSize = max<size_t>(options_.thread_count, 1);
+  vector<string> serialized(waveSize);
+
+  for (size_t wave = 0; wave < chunkCount; wave += waveSize) {
+    size_t count = min(waveSize, chunkCount - wave);
+    ParallelFor(count, options_.thread_count, [&](size_t first, size_t last) {
+      for (size_t i = first; i < last; ++i) {
+        size_t begin = (wave + i) * SaveChunkSize;
+        size_t end = min(begin + SaveChunkSize, sorted_contacts_.size());
+        serialized[i] = SerializeContacts(ContactRange(sorted_contacts_.begin() + begin,
+                                                       sorted_contacts_.begin() + end));
+      }
+    });
+    for (size_t i = 0; i < count; ++i) {
+      output.write(serialized[i].data(), serialized[i].size());
+    }
+  }
+
+  PhoneBookSerialize::ContactList indices;
+  if (!phone_index_.empty()) {
+    auto& phoneIndex = *indices.mutable_phone_index();
+    phoneIndex.mutable_key()->Reserve(phone_index_.size());
+    phoneIndex.mutable_contact()->Reserve(phone_index_.size());
+    phoneIndex.mutable_phone()->Reserve(phone_index_.size());
+    for (const auto& entry : phone_index_) {
+      phoneIndex.add_key(entry.key);
+      phoneIndex.add_contact(entry.contact);
+      phoneIndex.add_phone(entry.phone);
+    }
+  }
+  if (!birthday_index_.empty()) {
+    indices.mutable_birthday_index()->Add(birthday_index_.begin(), birthday_index_.end());
+  }
+  if (indices.ByteSizeLong() != 0) {
+    indices.SerializePartialToOstream(&output);
+  }
+}
+
+namespace {
+  using google::protobuf::internal::WireFormatLite;
+
+  constexpr uint32_t ContactListContactTag =
+    WireFormatLite::MakeTag(PhoneBookSerialize::ContactList::kContactFieldNumber,
+                            WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+
+  // Переносит поле ContactList, отличное от contact, в конец extras как есть
+  bool CopyField(google::protobuf::io::CodedInputStream& coded, uint32_t tag, string& extras) {
+    string field;
+    {
+      google::protobuf::io::StringOutputStream stream(&field);
+      google::protobuf::io::CodedOutputStream output(&stream);
+      if (!WireFormatLite::SkipField(&coded, tag, &output)) {
+        return false;
+      }
+    }
+    extras += field;
+    return true;
+  }
+
+  // Читает очередной контакт из потока ContactList; false, если поток закончился
+  // на границе поля, std::runtime_error, если он повреждён или оборван.
+  // ContactList на проводе — это последовательность полей contact с длиной, поэтому
+  // контакты можно разбирать по одному, не собирая весь список в памяти.
+  // Прочие поля ContactList (сохранённые индексы) копируются в extras
+  bool ReadNextContact(google::protobuf::io::ZeroCopyInputStream& stream, PhoneBookSerialize::Contact& contact,
+                       string& extras) {
+    // Отдельный CodedInputStream на каждый контакт, чтобы не упереться в общий лимит в 2 ГБ
+    google::protobuf::io::CodedInputStream coded(&stream);
+    while (uint32_t tag = coded.ReadTag()) {
+      if (tag != ContactListContactTag) {
+        if (!CopyField(coded, tag, extras)) {
+          throw runtime_error("Phone book contact is corrupted");
+        }
+        continue;
+      }
+
+      uint32_t length;
+      if (!coded.ReadVarint32(&length) || length > static_cast<uint32_t>(numeric_limits<int>::max())) {
+        throw runtime_error("Phone book contact is corrupted");
+      }
+      auto limit = coded.PushLimit(static_cast<int>(length));
+      contact.Clear();
+      if (!contact.MergeFromCodedStream(&coded) || !coded.ConsumedEntireMessage()) {
+        throw runtime_error("Phone book contact is corrupted");
+      }
+      coded.PopLimit(limit);
+      return true;
+    }
+    // Нулевой тег — либо конец потока, либо мусор вместо тега
+    if (!coded.ConsumedEntireMessage()) {
+      throw runtime_error("Phone book contact is corrupted");
+    }
+    return false;
+  }
+
+  Contact TakeContact(PhoneBookSerialize::Contact& contact) {
+    Contact sContact;
+    sContact.name = move(*contact.mutable_name());
     if (contact.has_birthday()) {
       sContact.birthday = Date {
         .year = contact.birthday().year(),
@@ -89,10 +472,168 @@ PhoneBook DeserializePhoneBook(istream& input) {
       };
     }
     sContact.phones.reserve(contact.phone_number_size());
-    for (auto& phone : contact.phone_number()) {
-      sContact.phones.push_back(phone);
+    for (auto& phone : *contact.mutable_phone_number()) {
+      sContact.phones.push_back(move(phone));
+    }
+    return sContact;
+  }
+
+  // Разбирает сохранённые индексы; индекс, не согласованный с контактами, отбрасывается
+  PhoneBook::PersistedIndices ParseIndices(const string& extras, const Contacts& contacts) {
+    PhoneBook::PersistedIndices indices;
+    PhoneBookSerialize::ContactList list;
+    if (extras.empty() || !list.ParsePartialFromString(extras)) {
+      return indices;
+    }
+
+    // Записи должны строго возрастать, ключ — совпадать с ключом своего телефона,
+    // а записей — быть столько же, сколько телефонов: тогда каждый телефон
+    // встречается ровно один раз
+    const auto& phoneIndex = list.phone_index();
+    size_t phoneCount = 0;
+    for (const auto& contact : contacts) {
+      phoneCount += contact.phones.size();
+    }
+    if (phoneIndex.key_size() == phoneIndex.contact_size() && phoneIndex.key_size() == phoneIndex.phone_size()
+        && static_cast<size_t>(phoneIndex.key_size()) == phoneCount) {
+      indices.phones.reserve(phoneIndex.key_size());
+      for (int i = 0; i < phoneIndex.key_size(); ++i) {
+        PhoneIndexEntry entry{phoneIndex.key(i), phoneIndex.contact(i), phoneIndex.phone(i)};
+        if (entry.contact >= contacts.size() || entry.phone >= contacts[entry.contact].phones.size()
+            || entry.key != PhoneNumber::Key(PhoneNumber::Digits(contacts[entry.contact].phones[entry.phone]))
+            || (!indices.phones.empty() && !(indices.phones.back() < entry))) {
+          indices.phones.clear();
+          break;
+        }
+        indices.phones.push_back(entry);
+      }
+    }
+
+    // Каждый контакт с днём рождения должен встретиться ровно один раз, по порядку дат
+    vector<bool> seen(contacts.size());
+    indices.birthdays.reserve(list.birthday_index_size());
+    for (auto contact : list.birthday_index()) {
+      if (contact >= contacts.size() || seen[contact] || !contacts[contact].birthday
+          || (!indices.birthdays.empty()
+              && BirthdayKey(contacts[contact]) < BirthdayKey(contacts[indices.birthdays.back()]))) {
+        indices.birthdays.clear();
+        break;
+      }
+      seen[contact] = true;
+      indices.birthdays.push_back(contact);
+    }
+    return indices;
+  }
+}
+
+namespace {
+  // Находит в буфере границы целиком прочитанных контактов. Возвращает число
+  // разобранных байт; незавершённый хвост остаётся до следующего блока.
+  // Длинное поле, отличное от contact (сохранённый индекс), переносится в extras
+  // по частям: pending_field — сколько его байт ещё не пришло, так что каждый
+  // блок просматривается один раз.
+  size_t FindContactFrames(string_view buffer, vector<string_view>& frames, string& extras, size_t& pending_field) {
+    size_t skipped = min(pending_field, buffer.size());
+    extras.append(buffer.substr(0, skipped));
+    pending_field -= skipped;
+    if (pending_field > 0) {
+      return skipped;
+    }
+
+    // CodedInputStream адресует не больше 2 ГБ; остаток дождётся следующего вызова
+    buffer = buffer.substr(skipped, min<size_t>(buffer.size() - skipped, numeric_limits<int>::max()));
+    google::protobuf::io::CodedInputStream coded(reinterpret_cast<const uint8_t*>(buffer.data()),
+                                                 static_cast<int>(buffer.size()));
+    size_t consumed = 0;
+    while (uint32_t tag = coded.ReadTag()) {
+      if (tag == ContactListContactTag) {
+        uint32_t length;
+        if (!coded.ReadVarint32(&length)) {
+          break;
+        }
+        if (length > static_cast<uint32_t>(numeric_limits<int>::max())) {
+          throw runtime_error("Phone book contact is corrupted");
+        }
+        size_t begin = coded.CurrentPosition();
+        if (!coded.Skip(static_cast<int>(length))) {
+          break;
+        }
+        frames.push_back(buffer.substr(begin, length));
+      } else if (WireFormatLite::GetTagWireType(tag) == WireFormatLite::WIRETYPE_LENGTH_DELIMITED) {
+        uint32_t length;
+        if (!coded.ReadVarint32(&length)) {
+          break;
+        }
+        // Тег и длина переносятся как есть, а тело — сколько его уже есть в буфере
+        size_t begin = coded.CurrentPosition();
+        size_t available = min<size_t>(length, buffer.size() - begin);
+        extras.append(buffer.substr(consumed, begin - consumed + available));
+        if (available < length) {
+          pending_field = length - available;
+          return skipped + buffer.size();
+        }
+        coded.Skip(static_cast<int>(length));
+      } else if (!CopyField(coded, tag, extras)) {
+        break;
+      }
+      consumed = coded.CurrentPosition();
+    }
+    return skipped + consumed;
+  }
+
+  Contacts DeserializeContactsParallel(istream& input, size_t threadCount, string& extras) {
+    Contacts sortedContacts;
+    string buffer;
+    vector<string_view> frames;
+    size_t pendingField = 0;
+    bool eof = false;
+
+    for (size_t blockSize = FirstLoadBlockSize; !eof; blockSize = min(blockSize * 2, LoadBlockSize)) {
+      size_t kept = buffer.size();
+      buffer.resize(kept + blockSize);
+      input.read(buffer.data() + kept, static_cast<streamsize>(blockSize));
+      buffer.resize(kept + input.gcount());
+      eof = !input;
+
+      frames.clear();
+      size_t consumed = FindContactFrames(buffer, frames, extras, pendingField);
+
+      size_t base = sortedContacts.size();
+      sortedContacts.resize(base + frames.size());
+      ParallelFor(frames.size(), frames.size() < ParallelThreshold ? 1 : threadCount, [&](size_t first, size_t last) {
+        PhoneBookSerialize::Contact contact;
+        for (size_t i = first; i < last; ++i) {
+          contact.Clear();
+          if (!contact.ParseFromArray(frames[i].data(), static_cast<int>(frames[i].size()))) {
+            throw runtime_error("Phone book contact is corrupted");
+          }
+          sortedContacts[base + i] = TakeContact(contact);
+        }
+      });
+
+      buffer.erase(0, consumed);
+    }
+    if (!buffer.empty() || pendingField > 0) {
+      throw runtime_error("Phone book contact is corrupted");
+    }
+    return sortedContacts;
+  }
+}
+
+PhoneBook DeserializePhoneBook(istream& input, PhoneBookOptions options) {
+  Contacts sortedContacts;
+  string extras;
+
+  if (options.thread_count > 1) {
+    sortedContacts = DeserializeContactsParallel(input, options.thread_count, extras);
+  } else {
+    google::protobuf::io::IstreamInputStream stream(&input);
+    PhoneBookSerialize::Contact contact;
+    while (ReadNextContact(stream, contact, extras)) {
+      sortedContacts.push_back(TakeContact(contact));
     }
   }
 
-  return PhoneBook(move(sortedContacts), 0);
+  auto indices = ParseIndices(extras, sortedContacts);
+  return PhoneBook(move(sortedContacts), 0, options, move(indices));
 }
@@ -1,13 +1,18 @@
 #pragma once
 
+#include "eytzinger_index.h"
 #include "iterator_range.h"
-#include "string_stringview_hash.h"
-#include "string_stringview_equal.h"
+#include "lru_cache.h"
+#include "prefix_index.h"
 
-#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 #include <iosfwd>
 #include <iterator>
@@ -16,18 +21,77 @@ struct Date {
   int year, month, day;
 };
 
+// День и месяц без года — ключ для ежегодных событий вроде дня рождения
+struct MonthDay {
+  int month, day;
+
+  auto operator<=>(const MonthDay&) const = default;
+};
+
 struct Contact {
   std::string name;
   std::optional<Date> birthday;
   std::vector<std::string> phones;
 };
 
+// Сравнивает контакты по имени, а контакт со строкой — по префиксу имени длины
+// этой строки, так что equal_range по строке даёт все контакты с таким префиксом
+struct ContactNameCompare {
+  typedef void is_transparent;
+  bool operator()(const Contact &l, const Contact &r) const {
+    return l.name < r.name;
+  }
+  bool operator()(const Contact &contact, std::string_view name) const {
+    std::string_view cname(contact.name.c_str(), std::min(name.size(), contact.name.size()));
+    return cname < name;
+  }
+  bool operator()(std::string_view name, const Contact &contact) const {
+    std::string_view cname(contact.name.c_str(), std::min(name.size(), contact.name.size()));
+    return name < cname;
+  }
+};
+
+struct PhoneBookOptions {
+  // Строить сжатое префиксное дерево: FindByNamePrefix за O(длина префикса)
+  bool prefix_index = false;
+  // Искать по первым 8 байтам имён, разложенным в порядке Эйтцингера: быстрее
+  // двоичного поиска по контактам на больших книгах, кэш не используется.
+  // Вместе с prefix_index не строится: поиск идёт по префиксному дереву.
+  bool eytzinger_index = false;
+  // Ёмкость LRU-кэша результатов FindByNamePrefix, 0 выключает кэш
+  size_t cache_capacity = 1 << 16;
+  size_t cache_shards = 16;
+  // Строить индекс по нормализованным номерам для FindByPhone
+  bool phone_index = false;
+  // Строить массив имён в нижнем регистре для FindByFoldedNamePrefix
+  bool folded_names = false;
+  // Строить индекс по (месяц, день) рождения для FindByBirthday
+  bool birthday_index = false;
+  // Потоки для сортировки при построении, SaveTo и DeserializePhoneBook
+  size_t thread_count = std::thread::hardware_concurrency();
+};
+
+struct PhoneIndexEntry {
+  uint64_t key;
+  uint32_t contact, phone;
+
+  auto operator<=>(const PhoneIndexEntry&) const = default;
+};
+
 class PhoneBook {
 public:
   using Contacts = std::vector<Contact>;
   using ContactRange = IteratorRange<Contacts::const_iterator>;
+  using ContactPtrRange = IteratorRange<std::vector<const Contact*>::const_iterator>;
+  using CacheStats = ShardedLruCache<ContactRange>::Stats;
+
+  // Индексы, сохранённые вместе с книгой; пустые строятся заново
+  struct PersistedIndices {
+    std::vector<PhoneIndexEntry> phones;
+    std::vector<uint32_t> birthdays;
+  };
 
-  explicit PhoneBook(Contacts contacts);
+  explicit PhoneBook(Contacts contacts, PhoneBookOptions options = {});
 
   PhoneBook(PhoneBook&&) = default;
   PhoneBook& operator=(PhoneBook&&) = default;
@@ -35,20 +99,62 @@ public:
   PhoneBook(const PhoneBook&) = delete;
   PhoneBook& operator=(const PhoneBook&) = delete;
 
+  // Безопасно вызывать одновременно из нескольких потоков
   ContactRange FindByNamePrefix(std::string_view name_prefix) const;
 
+  // Сужает range, найденный для префикса longer_prefix, до контактов с longer_prefix
+  // за O(log range.size())
+  ContactRange Narrow(ContactRange range, std::string_view longer_prefix) const;
+
+  // Ответы на несколько префиксов в исходном порядке. Префиксы обрабатываются по
+  // возрастанию, и каждый ищется внутри ответа на самый длинный свой префикс из
+  // пакета, поэтому цепочки вроде "I", "Iv", "Iva" стоят как сужения
+  std::vector<ContactRange> FindByNamePrefixes(std::span<const std::string_view> name_prefixes) const;
+
+  // Поиск по префиксу без учёта регистра (см. FoldCase). Ключи всех контактов
+  // приводятся к нижнему регистру при построении, так что запрос стоит столько же,
+  // сколько FindByNamePrefix. Контакты упорядочены по ключу, а не по имени.
+  // Требует PhoneBookOptions::folded_names, иначе возвращает пустой диапазон.
+  ContactPtrRange FindByFoldedNamePrefix(std::string_view name_prefix) const;
+
+  CacheStats GetCacheStats() const;
+
+  // Контакты, у которых есть номер с теми же цифрами, что и phone; форматирование
+  // не учитывается. Без PhoneBookOptions::phone_index просматривает всю книгу.
+  std::vector<const Contact*> FindByPhone(std::string_view phone) const;
+
+  // Контакты, чей день рождения попадает в окно [from, to] включительно, по порядку
+  // дат начиная с from; год рождения не учитывается. Если to раньше from, окно
+  // переходит через конец года. С PhoneBookOptions::birthday_index стоит
+  // O(log N + k), иначе просматривает всю книгу.
+  std::vector<const Contact*> FindByBirthday(MonthDay from, MonthDay to) const;
+
   void SaveTo(std::ostream& output) const;
 
-  friend PhoneBook DeserializePhoneBook(std::istream& input);
+  friend PhoneBook DeserializePhoneBook(std::istream& input, PhoneBookOptions options);
+  friend class LivePhoneBook;
 
 private:
-  PhoneBook(Contacts sorted_contacts, int);
+  PhoneBook(Contacts sorted_contacts, int, PhoneBookOptions options = {}, PersistedIndices indices = {});
+
+  void BuildIndices();
+  void BuildBirthdayIndex();
+  void BuildFoldedNames();
 
+  PhoneBookOptions options_;
   Contacts sorted_contacts_;
-  mutable std::unordered_map<std::string, ContactRange,
-                             string_stringview::Hash,
-                             string_stringview::Equal> cache_;
+  PrefixIndex prefix_index_;
+  EytzingerIndex eytzinger_index_;
+  std::vector<PhoneIndexEntry> phone_index_;
+  // Индексы контактов с днём рождения, по возрастанию (месяц, день)
+  std::vector<uint32_t> birthday_index_;
+  // Имена в нижнем регистре подряд, по возрастанию, и их контакты в том же порядке
+  std::string folded_names_;
+  std::vector<uint64_t> folded_offsets_;
+  std::vector<const Contact*> folded_contacts_;
+  std::unique_ptr<ShardedLruCache<ContactRange>> cache_;
 };
 
-PhoneBook DeserializePhoneBook(std::istream& input);
+// Бросает std::runtime_error, если контакт в потоке повреждён или оборван
+PhoneBook DeserializePhoneBook(std::istream& input, PhoneBookOptions options = {});
 
@@ -0,0 +1,263 @@
+#include "phone_book.h"
+#include "flat_phone_book.h"
+#include "phone_number.h"
+#include "synthetic_contacts.h"
+
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+void BenchmarkPrefixSearch(size_t contactCount, size_t queryCount) {
+  mt19937 gen(42);
+  auto contacts = GenerateContacts(contactCount, gen);
+  auto prefixes = GeneratePrefixes(contacts, queryCount, gen);
+
+  cout << contactCount << " contacts, " << queryCount << " queries" << endl;
+  // Все варианты без кэша: иначе двоичный поиск платит ещё и за обращения к нему
+  vector<pair<string, PhoneBookOptions>> variants = {
+      {"binary search", {.cache_capacity = 0}},
+      {"prefix index", {.prefix_index = true, .cache_capacity = 0}},
+      {"eytzinger", {.eytzinger_index = true, .cache_capacity = 0}},
+  };
+  for (const auto& [label, options] : variants) {
+    Stopwatch build;
+    PhoneBook book(contacts, options);
+    double buildSeconds = build.Seconds();
+
+    size_t found = 0;
+    Stopwatch search;
+    for (const auto& prefix : prefixes) {
+      found += book.FindByNamePrefix(prefix).size();
+    }
+    double searchSeconds = search.Seconds();
+
+    cout << setw(14) << left << label << right
+         << " build " << fixed << setprecision(2) << buildSeconds << " s"
+         << ", search " << setprecision(0) << searchSeconds * 1e9 / queryCount << " ns/query"
+         << " (" << found << " found)" << endl;
+  }
+}
+
+// Поиск без учёта регистра против обычного на тех же префиксах, записанных
+// заглавными буквами: ответы совпадают, если все имена начинаются с заглавной
+void BenchmarkFoldedSearch(size_t contactCount, size_t queryCount) {
+  mt19937 gen(42);
+  auto contacts = GenerateContacts(contactCount, gen);
+  auto prefixes = GeneratePrefixes(contacts, queryCount, gen);
+  PhoneBook book(move(contacts), {.cache_capacity = 0, .folded_names = true});
+
+  vector<string> shouted;
+  shouted.reserve(prefixes.size());
+  for (const auto& prefix : prefixes) {
+    auto& query = shouted.emplace_back(prefix);
+    for (auto& c : query) {
+      c = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+    }
+  }
+
+  size_t exactFound = 0;
+  Stopwatch exact;
+  for (const auto& prefix : prefixes) {
+    exactFound += book.FindByNamePrefix(prefix).size();
+  }
+  double exactSeconds = exact.Seconds();
+
+  size_t foldedFound = 0;
+  Stopwatch folded;
+  for (const auto& query : shouted) {
+    foldedFound += book.FindByFoldedNamePrefix(query).size();
+  }
+  double foldedSeconds = folded.Seconds();
+
+  cout << "case-insensitive search: exact " << setprecision(0) << exactSeconds * 1e9 / queryCount << " ns/query"
+       << ", folded " << foldedSeconds * 1e9 / queryCount << " ns/query"
+       << " (" << exactFound << " / " << foldedFound << " found)" << endl;
+}
+
+// Оценка кучи, занятой контактами: сами Contact, буферы длинных строк и векторов
+size_t EstimateMemory(PhoneBook::ContactRange contacts) {
+  auto heapString = [](const string& s) {
+    return s.capacity() > 15 ? s.capacity() + 1 : 0;
+  };
+  size_t bytes = 0;
+  for (const auto& contact : contacts) {
+    bytes += sizeof(Contact) + heapString(contact.name) + contact.phones.capacity() * sizeof(string);
+    for (const auto& phone : contact.phones) {
+      bytes += heapString(phone);
+    }
+  }
+  return bytes;
+}
+
+void BenchmarkCompactStorage(size_t contactCount, size_t queryCount) {
+  mt19937 gen(42);
+  auto contacts = GenerateContacts(contactCount, gen);
+  auto prefixes = GeneratePrefixes(contacts, queryCount, gen);
+  PhoneBook book(move(contacts), {.cache_capacity = 0});
+  auto compact = FlatPhoneBook::Build(book);
+
+  size_t found = 0;
+  Stopwatch bookSearch;
+  for (const auto& prefix : prefixes) {
+    found += book.FindByNamePrefix(prefix).size();
+  }
+  double bookSeconds = bookSearch.Seconds();
+
+  Stopwatch compactSearch;
+  for (const auto& prefix : prefixes) {
+    found -= compact.FindByNamePrefix(prefix).size();
+  }
+  double compactSeconds = compactSearch.Seconds();
+
+  cout << "memory: contacts " << EstimateMemory(book.FindByNamePrefix("")) / (1 << 20) << " MB"
+       << ", compact " << compact.ByteSize() / (1 << 20) << " MB" << endl;
+  cout << "uncached search: contacts " << setprecision(0) << bookSeconds * 1e9 / queryCount << " ns/query"
+       << ", compact " << compactSeconds * 1e9 / queryCount << " ns/query"
+       << (found == 0 ? "" : " (MISMATCH)") << endl;
+}
+
+void BenchmarkPhoneEncoding(size_t contactCount) {
+  mt19937 gen(42);
+  auto contacts = GenerateContacts(contactCount, gen);
+
+  size_t textBytes = 0;
+  string packed;
+  PhoneNumber::TemplateTable templates;
+  for (const auto& contact : contacts) {
+    for (const auto& phone : contact.phones) {
+      textBytes += phone.size();
+      templates.Encode(phone, packed);
+    }
+  }
+  cout << "phones: text " << textBytes << " bytes, packed " << packed.size() << " bytes"
+       << " (" << templates.Templates().size() - 1 << " templates)" << endl;
+}
+
+void BenchmarkPhoneLookup(size_t contactCount, size_t queryCount) {
+  mt19937 gen(42);
+  auto contacts = GenerateContacts(contactCount, gen);
+
+  vector<string> queries;
+  uniform_int_distribution<size_t> contact(0, contacts.size() - 1);
+  while (queries.size() < queryCount) {
+    const auto& phones = contacts[contact(gen)].phones;
+    if (!phones.empty()) {
+      queries.push_back(phones.front());
+    }
+  }
+
+  Stopwatch build;
+  PhoneBook book(move(contacts), {.phone_index = true});
+  double buildSeconds = build.Seconds();
+
+  size_t found = 0;
+  Stopwatch lookup;
+  for (const auto& query : queries) {
+    found += book.FindByPhone(query).size();
+  }
+  double lookupSeconds = lookup.Seconds();
+
+  cout << "phone index: build " << setprecision(2) << buildSeconds << " s"
+       << ", lookup " << setprecision(0) << lookupSeconds * 1e9 / queryCount << " ns/query"
+       << " (" << found << " found)" << endl;
+}
+
+// Автодополнение: префиксы длиной 1..n одного имени, как при наборе по букве
+void BenchmarkAutocomplete(size_t contactCount, size_t queryCount) {
+  mt19937 gen(42);
+  auto contacts = GenerateContacts(contactCount, gen);
+  auto names = GeneratePrefixes(contacts, queryCount / 8 + 1, gen);
+  PhoneBook book(move(contacts), {.cache_capacity = 0});
+
+  vector<string_view> keystrokes;
+  for (const auto& name : names) {
+    for (size_t length = 1; length <= name.size(); ++length) {
+      keystrokes.push_back(string_view(name).substr(0, length));
+    }
+  }
+
+  size_t independentFound = 0;
+  Stopwatch independent;
+  for (auto prefix : keystrokes) {
+    independentFound += book.FindByNamePrefix(prefix).size();
+  }
+  double independentSeconds = independent.Seconds();
+
+  size_t narrowFound = 0;
+  Stopwatch narrowing;
+  for (const auto& name : names) {
+    auto range = book.FindByNamePrefix(string_view(name).substr(0, 1));
+    narrowFound += range.size();
+    for (size_t length = 2; length <= name.size(); ++length) {
+      range = book.Narrow(range, string_view(name).substr(0, length));
+      narrowFound += range.size();
+    }
+  }
+  double narrowingSeconds = narrowing.Seconds();
+
+  size_t batchFound = 0;
+  Stopwatch batched;
+  for (auto range : book.FindByNamePrefixes(keystrokes)) {
+    batchFound += range.size();
+  }
+  double batchedSeconds = batched.Seconds();
+
+  cout << "autocomplete: independent " << setprecision(0) << independentSeconds * 1e9 / keystrokes.size() << " ns/key"
+       << ", narrow " << narrowingSeconds * 1e9 / keystrokes.size() << " ns/key"
+       << ", batch " << batchedSeconds * 1e9 / keystrokes.size() << " ns/key"
+       << (independentFound == narrowFound && narrowFound == batchFound ? "" : " (MISMATCH)") << endl;
+}
+
+void BenchmarkLoad(size_t contactCount) {
+  mt19937 gen(42);
+  PhoneBook book(GenerateContacts(contactCount, gen));
+
+  auto protoPath = filesystem::temp_directory_path() / "phone_book_benchmark.pb";
+  auto flatPath = filesystem::temp_directory_path() / "phone_book_benchmark.flat";
+  {
+    ofstream output(protoPath, ios::binary);
+    book.SaveTo(output);
+  }
+  {
+    ofstream output(flatPath, ios::binary);
+    SaveFlatPhoneBook(book, output);
+  }
+
+  Stopwatch protoLoad;
+  {
+    ifstream input(protoPath, ios::binary);
+    auto loaded = DeserializePhoneBook(input);
+  }
+  double protoSeconds = protoLoad.Seconds();
+
+  Stopwatch flatLoad;
+  auto flat = FlatPhoneBook::Map(flatPath);
+  double flatSeconds = flatLoad.Seconds();
+
+  cout << "load: protobuf " << fixed << setprecision(3) << protoSeconds << " s"
+       << ", flat mmap " << setprecision(6) << flatSeconds << " s"
+       << " (" << flat.size() << " contacts)" << endl;
+
+  filesystem::remove(protoPath);
+  filesystem::remove(flatPath);
+}
+
+int main(int argc, char* argv[]) {
+  size_t contactCount = argc > 1 ? stoul(argv[1]) : 10'000'000;
+  size_t queryCount = argc > 2 ? stoul(argv[2]) : 1'000'000;
+  BenchmarkPrefixSearch(contactCount, queryCount);
+  BenchmarkAutocomplete(contactCount, queryCount);
+  BenchmarkFoldedSearch(contactCount, queryCount);
+  BenchmarkCompactStorage(contactCount, queryCount);
+  BenchmarkPhoneEncoding(contactCount);
+  BenchmarkPhoneLookup(contactCount, queryCount);
+  BenchmarkLoad(contactCount);
+  return 0;
+}
@@ -0,0 +1,168 @@
+#include "phone_book.h"
+#include "synthetic_contacts.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Нагрузочный прогон для оценки размеров развёртывания. Для каждого размера книги
+// и распределения имён печатает время построения, пропускную способность SaveTo и
+// DeserializePhoneBook и перцентили задержки FindByNamePrefix без кэша, с пустым и
+// с прогретым кэшем, в одном и в нескольких потоках.
+//
+// Запуск: PhoneBookLoadTest [максимум контактов] [запросов] [потоков]
+// По умолчанию — до 1M контактов, это несколько сотен мегабайт памяти. Размеры
+// идут до 50M; им нужно около 15 ГБ, потому что генератор держит копию контактов.
+
+struct Latencies {
+  vector<double> nanoseconds;
+  double wall_seconds = 0;
+  size_t found = 0;
+};
+
+// Запросы популярны по закону Ципфа: небольшое число префиксов повторяется часто
+vector<string_view> GenerateQueries(const vector<string>& pool, size_t count, mt19937& gen) {
+  ZipfDistribution popularity(pool.size(), 1.0);
+  vector<string_view> queries(count);
+  for (auto& query : queries) {
+    query = pool[popularity(gen)];
+  }
+  return queries;
+}
+
+Latencies MeasureSearch(const PhoneBook& book, span<const string_view> queries, size_t threadCount) {
+  vector<Latencies> parts(threadCount);
+  Stopwatch wall;
+  vector<future<void>> futures;
+  for (size_t t = 0; t < threadCount; ++t) {
+    futures.push_back(async(launch::async, [&, t] {
+      auto& part = parts[t];
+      part.nanoseconds.reserve(queries.size() / threadCount + 1);
+      for (size_t i = t; i < queries.size(); i += threadCount) {
+        auto start = chrono::steady_clock::now();
+        part.found += book.FindByNamePrefix(queries[i]).size();
+        chrono::duration<double, nano> elapsed = chrono::steady_clock::now() - start;
+        part.nanoseconds.push_back(elapsed.count());
+      }
+    }));
+  }
+  for (auto& f : futures) {
+    f.get();
+  }
+
+  Latencies result;
+  result.wall_seconds = wall.Seconds();
+  for (auto& part : parts) {
+    result.nanoseconds.insert(result.nanoseconds.end(), part.nanoseconds.begin(), part.nanoseconds.end());
+    result.found += part.found;
+  }
+  sort(result.nanoseconds.begin(), result.nanoseconds.end());
+  return result;
+}
+
+void PrintLatencies(const string& label, const Latencies& latencies) {
+  const auto& ns = latencies.nanoseconds;
+  auto percentile = [&ns](double p) {
+    return ns.empty() ? 0.0 : ns[min(ns.size() - 1, static_cast<size_t>(p * ns.size()))];
+  };
+  cout << "  " << setw(22) << left << label << right << fixed << setprecision(0)
+       << " p50 " << setw(7) << percentile(0.5)
+       << " p90 " << setw(7) << percentile(0.9)
+       << " p99 " << setw(8) << percentile(0.99)
+       << " p99.9 " << setw(8) << percentile(0.999)
+       << " max " << setw(9) << (ns.empty() ? 0.0 : ns.back()) << " ns"
+       << ", " << setprecision(2) << ns.size() / latencies.wall_seconds / 1e6 << " Mqps" << endl;
+}
+
+void LoadTest(size_t contactCount, const string& distribution, ContactGeneratorOptions generator,
+              size_t queryCount, size_t threadCount) {
+  mt19937 gen(42);
+  auto contacts = GenerateContacts(contactCount, gen, generator);
+  auto pool = GeneratePrefixes(contacts, min<size_t>(queryCount, 100'000), gen);
+  auto queries = GenerateQueries(pool, queryCount, gen);
+
+  cout << contactCount << " contacts, " << distribution << " names" << endl;
+
+  double singleBuildSeconds;
+  {
+    auto copy = contacts;
+    Stopwatch build;
+    PhoneBook book(move(copy), {.thread_count = 1});
+    singleBuildSeconds = build.Seconds();
+  }
+  auto path = filesystem::temp_directory_path() / "phone_book_load_test.pb";
+  double saveSeconds;
+  {
+    Stopwatch build;
+    PhoneBook book(move(contacts), {.thread_count = threadCount});
+    double buildSeconds = build.Seconds();
+    cout << "  build: 1 thread " << fixed << setprecision(3) << singleBuildSeconds << " s"
+         << ", " << threadCount << " threads " << buildSeconds << " s" << endl;
+
+    Stopwatch save;
+    ofstream output(path, ios::binary);
+    book.SaveTo(output);
+    output.close();
+    saveSeconds = save.Seconds();
+  }
+  double megabytes = filesystem::file_size(path) / double(1 << 20);
+  cout << "  save: " << setprecision(1) << megabytes << " MB, "
+       << megabytes / saveSeconds << " MB/s" << endl;
+
+  vector<size_t> threadCounts = {1};
+  if (threadCount > 1) {
+    threadCounts.push_back(threadCount);
+  }
+  auto threadsLabel = [](size_t threads) {
+    return to_string(threads) + (threads == 1 ? " thread" : " threads");
+  };
+
+  cout << "  load:";
+  for (size_t threads : threadCounts) {
+    Stopwatch load;
+    ifstream input(path, ios::binary);
+    auto loaded = DeserializePhoneBook(input, {.thread_count = threads});
+    cout << (threads == 1 ? " " : ", ") << threadsLabel(threads) << " " << megabytes / load.Seconds() << " MB/s";
+  }
+  cout << endl;
+
+  // Каждый сценарий — на свежей книге из файла, в одном и в нескольких потоках.
+  // Первый проход по книге с кэшем заполняет его, второй идёт по прогретому.
+  for (size_t threads : threadCounts) {
+    {
+      ifstream input(path, ios::binary);
+      auto uncached = DeserializePhoneBook(input, {.cache_capacity = 0, .thread_count = threadCount});
+      PrintLatencies("no cache, " + threadsLabel(threads), MeasureSearch(uncached, queries, threads));
+    }
+    ifstream input(path, ios::binary);
+    auto cached = DeserializePhoneBook(input, {.thread_count = threadCount});
+    PrintLatencies("cold cache, " + threadsLabel(threads), MeasureSearch(cached, queries, threads));
+    PrintLatencies("warm cache, " + threadsLabel(threads), MeasureSearch(cached, queries, threads));
+  }
+  filesystem::remove(path);
+}
+
+int main(int argc, char* argv[]) {
+  size_t maxContacts = argc > 1 ? stoul(argv[1]) : 1'000'000;
+  size_t queryCount = argc > 2 ? stoul(argv[2]) : 1'000'000;
+  size_t threadCount = argc > 3 ? stoul(argv[3]) : max(thread::hardware_concurrency(), 1u);
+
+  for (size_t contactCount : {1'000, 10'000, 100'000, 1'000'000, 10'000'000, 50'000'000}) {
+    if (contactCount > maxContacts) {
+      break;
+    }
+    LoadTest(contactCount, "uniform", {.birthday_share = 0.7}, queryCount, threadCount);
+    LoadTest(contactCount, "zipf", {.name_skew = 1.1, .birthday_share = 0.7}, queryCount, threadCount);
+  }
+  return 0;
+}
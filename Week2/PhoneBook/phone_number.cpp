@@ -0,0 +1,111 @@
+#include "phone_number.h"
+
+using namespace std;
+
+namespace PhoneNumber {
+  namespace {
+    bool IsDigit(char c) {
+      return c >= '0' && c <= '9';
+    }
+
+    void WriteVarint(uint32_t value, string& output) {
+      while (value >= 0x80) {
+        output.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+      }
+      output.push_back(static_cast<char>(value));
+    }
+  }
+
+  string Digits(string_view phone) {
+    string digits;
+    for (char c : phone) {
+      if (IsDigit(c)) {
+        digits.push_back(c);
+      }
+    }
+    return digits;
+  }
+
+  uint64_t Key(string_view digits) {
+    uint64_t key = 0;
+    for (size_t i = 0; i < KeyDigits; ++i) {
+      key = (key << 4) | (i < digits.size() ? static_cast<uint64_t>(digits[i] - '0') : 0x0F);
+    }
+    return key;
+  }
+
+  TemplateTable::TemplateTable()
+    : templates_(1)
+  {}
+
+  void TemplateTable::Encode(string_view phone, string& output) {
+    if (phone.find(DigitPlaceholder) != string_view::npos) {
+      WriteVarint(RawTemplateId, output);
+      output.append(phone);
+      return;
+    }
+
+    string pattern(phone);
+    unsigned char pending = 0;
+    size_t digitCount = 0;
+    string packed;
+    for (auto& c : pattern) {
+      if (!IsDigit(c)) {
+        continue;
+      }
+      auto nibble = static_cast<unsigned char>(c - '0');
+      if (digitCount % 2 == 0) {
+        pending = static_cast<unsigned char>(nibble << 4);
+      } else {
+        packed.push_back(static_cast<char>(pending | nibble));
+      }
+      ++digitCount;
+      c = DigitPlaceholder;
+    }
+    if (digitCount % 2 == 1) {
+      packed.push_back(static_cast<char>(pending | 0x0F));
+    }
+
+    auto [it, inserted] = ids_.emplace(move(pattern), static_cast<uint32_t>(templates_.size()));
+    if (inserted) {
+      templates_.push_back(it->first);
+    }
+    WriteVarint(it->second, output);
+    output += packed;
+  }
+
+  string DecodeDigits(string_view packed) {
+    if (Detail::ReadVarint(packed) == RawTemplateId) {
+      return Digits(packed);
+    }
+
+    string digits;
+    digits.reserve(packed.size() * 2);
+    for (char c : packed) {
+      auto byte = static_cast<unsigned char>(c);
+      digits.push_back(static_cast<char>('0' + (byte >> 4)));
+      if ((byte & 0x0F) != 0x0F) {
+        digits.push_back(static_cast<char>('0' + (byte & 0x0F)));
+      }
+    }
+    return digits;
+  }
+
+  uint32_t Detail::ReadVarint(string_view& data) {
+    // uint32_t занимает не больше пяти байт, и в пятом значимы только младшие 4 бита
+    uint32_t value = 0;
+    for (size_t i = 0; i < data.size() && i < 5; ++i) {
+      auto byte = static_cast<unsigned char>(data[i]);
+      if (i == 4 && byte > 0x0F) {
+        break;
+      }
+      value |= static_cast<uint32_t>(byte & 0x7F) << (7 * i);
+      if (byte < 0x80) {
+        data.remove_prefix(i + 1);
+        return value;
+      }
+    }
+    throw runtime_error("Packed phone is corrupted");
+  }
+}
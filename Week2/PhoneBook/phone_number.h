@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Упакованное представление телефонных номеров.
+// Номер раскладывается на цифры и шаблон форматирования — исходную строку, в
+// которой каждая цифра заменена на DigitPlaceholder. Шаблонов на практике
+// немного, поэтому они хранятся один раз в таблице, а номер кодируется как
+// varint-идентификатор шаблона и цифры по две в байте (нечётное число цифр
+// дополняется полубайтом 0xF). Восстановление без потерь;
+// номера, содержащие сам DigitPlaceholder, хранятся как есть под RawTemplateId.
+// Так хранит номера плоский формат — и в файле, и в образе FlatPhoneBook::Build;
+// Contact::phones в PhoneBook остаются строками.
+// Decode и DecodeDigits бросают std::runtime_error на повреждённом номере.
+namespace PhoneNumber {
+  constexpr char DigitPlaceholder = '\0';
+  constexpr uint32_t RawTemplateId = 0;
+
+  // Нормализованный номер: только цифры, в исходном порядке
+  std::string Digits(std::string_view phone);
+
+  // Ключ нормализованного номера для индексов: первые KeyDigits цифр по полубайту,
+  // остаток заполнен 0xF. Для номеров из KeyDigits цифр и длиннее ключ неоднозначен.
+  constexpr size_t KeyDigits = 16;
+  uint64_t Key(std::string_view digits);
+
+  class TemplateTable {
+  public:
+    TemplateTable();
+
+    // Добавляет упакованный номер в конец output
+    void Encode(std::string_view phone, std::string& output);
+
+    const std::vector<std::string>& Templates() const {
+      return templates_;
+    }
+
+  private:
+    std::vector<std::string> templates_;
+    std::unordered_map<std::string, uint32_t> ids_;
+  };
+
+  // template_at(id) -> string_view возвращает шаблон по идентификатору
+  template <class TemplateAt>
+  std::string Decode(std::string_view packed, TemplateAt template_at);
+
+  // Только цифры номера, без шаблона; для RawTemplateId — цифры исходной строки
+  std::string DecodeDigits(std::string_view packed);
+
+  namespace Detail {
+    uint32_t ReadVarint(std::string_view& data);
+  }
+}
+
+template <class TemplateAt>
+std::string PhoneNumber::Decode(std::string_view packed, TemplateAt template_at) {
+  uint32_t id = Detail::ReadVarint(packed);
+  if (id == RawTemplateId) {
+    return std::string(packed);
+  }
+
+  std::string result(template_at(id));
+  size_t digit = 0;
+  for (auto& c : result) {
+    if (c == DigitPlaceholder) {
+      if (digit / 2 >= packed.size()) {
+        throw std::runtime_error("Packed phone is corrupted");
+      }
+      auto byte = static_cast<unsigned char>(packed[digit / 2]);
+      c = static_cast<char>('0' + (digit % 2 == 0 ? byte >> 4 : byte & 0x0F));
+      ++digit;
+    }
+  }
+  return result;
+}
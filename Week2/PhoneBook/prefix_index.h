@@ -0,0 +1,127 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// Сжатое префиксное дерево над отсортированным массивом имён.
+// Каждый узел хранит диапазон индексов [first, last) имён, начинающихся с его
+// строки, поэтому поиск по префиксу занимает O(длина префикса) и не зависит от
+// числа имён. Сами строки в индексе не хранятся: рёбра сравниваются с именем
+// первого контакта узла, которое достаётся через NameAt(size_t) -> string_view.
+class PrefixIndex {
+public:
+  using Range = std::pair<size_t, size_t>;
+
+  PrefixIndex() = default;
+
+  template <class NameAt>
+  PrefixIndex(size_t count, NameAt name_at);
+
+  template <class NameAt>
+  Range Find(std::string_view prefix, NameAt name_at) const;
+
+  size_t NodeCount() const {
+    return nodes_.size();
+  }
+
+private:
+  struct Node {
+    uint32_t first, last;
+    uint32_t depth;
+  };
+  struct Edge {
+    unsigned char label;
+    uint32_t node;
+  };
+
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> edge_offsets_;
+  std::vector<Edge> edges_;
+};
+
+template <class NameAt>
+PrefixIndex::PrefixIndex(size_t count, NameAt name_at) {
+  nodes_.push_back({0, static_cast<uint32_t>(count), 0});
+
+  std::vector<std::tuple<uint32_t, unsigned char, uint32_t>> edges;
+  std::vector<uint32_t> stack = {0};
+
+  auto close = [&](size_t last) {
+    uint32_t node = stack.back();
+    stack.pop_back();
+    nodes_[node].last = static_cast<uint32_t>(last);
+    return node;
+  };
+  auto attach = [&](uint32_t node) {
+    uint32_t parent = stack.back();
+    auto label = static_cast<unsigned char>(name_at(nodes_[node].first)[nodes_[parent].depth]);
+    edges.emplace_back(parent, label, node);
+  };
+  auto split = [&](size_t i, size_t lcp) {
+    while (nodes_[stack.back()].depth > lcp) {
+      uint32_t node = close(i);
+      if (nodes_[stack.back()].depth < lcp) {
+        stack.push_back(static_cast<uint32_t>(nodes_.size()));
+        nodes_.push_back({nodes_[node].first, 0, static_cast<uint32_t>(lcp)});
+      }
+      attach(node);
+    }
+  };
+
+  std::string_view previous;
+  for (size_t i = 0; i < count; ++i) {
+    std::string_view name = name_at(i);
+    auto lcp = static_cast<size_t>(
+      std::mismatch(previous.begin(), previous.end(), name.begin(), name.end()).first - previous.begin()
+    );
+    split(i, lcp);
+    if (name.size() > nodes_[stack.back()].depth) {
+      stack.push_back(static_cast<uint32_t>(nodes_.size()));
+      nodes_.push_back({static_cast<uint32_t>(i), 0, static_cast<uint32_t>(name.size())});
+    }
+    previous = name;
+  }
+  split(count, 0);
+  nodes_[0].last = static_cast<uint32_t>(count);
+
+  std::sort(edges.begin(), edges.end());
+  edge_offsets_.assign(nodes_.size() + 1, 0);
+  edges_.reserve(edges.size());
+  for (auto& [parent, label, node] : edges) {
+    ++edge_offsets_[parent + 1];
+    edges_.push_back({label, node});
+  }
+  for (size_t i = 1; i < edge_offsets_.size(); ++i) {
+    edge_offsets_[i] += edge_offsets_[i - 1];
+  }
+}
+
+template <class NameAt>
+PrefixIndex::Range PrefixIndex::Find(std::string_view prefix, NameAt name_at) const {
+  uint32_t node = 0;
+  size_t pos = 0;
+  while (pos < prefix.size()) {
+    auto first = edges_.begin() + edge_offsets_[node];
+    auto last = edges_.begin() + edge_offsets_[node + 1];
+    auto label = static_cast<unsigned char>(prefix[pos]);
+    auto edge = std::lower_bound(first, last, label, [](const Edge& e, unsigned char c) {
+      return e.label < c;
+    });
+    if (edge == last || edge->label != label) {
+      return {0, 0};
+    }
+
+    node = edge->node;
+    size_t until = std::min<size_t>(prefix.size(), nodes_[node].depth);
+    std::string_view name = name_at(nodes_[node].first);
+    if (name.substr(pos, until - pos) != prefix.substr(pos, until - pos)) {
+      return {0, 0};
+    }
+    pos = until;
+  }
+  return {nodes_[node].first, nodes_[node].last};
+}
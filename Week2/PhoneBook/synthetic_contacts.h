@@ -0,0 +1,119 @@
+#pragma once
+
+#include "phone_book.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+// Генераторы синтетических телефонных книг для бенчмарков
+
+class Stopwatch {
+  std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+
+public:
+  double Seconds() const {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_;
+    return elapsed.count();
+  }
+};
+
+// Распределение Ципфа на [0, n): P(i) ~ 1 / (i + 1)^skew
+class ZipfDistribution {
+public:
+  ZipfDistribution(size_t n, double skew)
+    : cdf_(n)
+  {
+    double sum = 0;
+    for (size_t i = 0; i < n; ++i) {
+      sum += 1.0 / std::pow(static_cast<double>(i + 1), skew);
+      cdf_[i] = sum;
+    }
+    for (auto& value : cdf_) {
+      value /= sum;
+    }
+  }
+
+  template <class Generator>
+  size_t operator()(Generator& gen) const {
+    double point = std::uniform_real_distribution<double>(0, 1)(gen);
+    auto it = std::lower_bound(cdf_.begin(), cdf_.end(), point);
+    return std::min<size_t>(it - cdf_.begin(), cdf_.size() - 1);
+  }
+
+private:
+  std::vector<double> cdf_;
+};
+
+struct ContactGeneratorOptions {
+  // 0 — слова имён равновероятны; больше 0 — имя и фамилия берутся из словаря
+  // по закону Ципфа с этим показателем, как в настоящих справочниках
+  double name_skew = 0;
+  size_t vocabulary_size = 20'000;
+  // Доля контактов с днём рождения
+  double birthday_share = 0;
+};
+
+inline PhoneBook::Contacts GenerateContacts(size_t count, std::mt19937& gen, ContactGeneratorOptions options = {}) {
+  static const std::vector<std::string> syllables = {
+    "an", "va", "ni", "ko", "lo", "ser", "gei", "ma", "ri", "na",
+    "pe", "tro", "ov", "ev", "in", "ka", "ya", "mi", "ha", "il",
+  };
+  std::uniform_int_distribution<size_t> syllable(0, syllables.size() - 1);
+  std::uniform_int_distribution<int> length(2, 4);
+
+  auto word = [&] {
+    std::string result;
+    for (int i = length(gen); i > 0; --i) {
+      result += syllables[syllable(gen)];
+    }
+    result[0] = static_cast<char>(std::toupper(result[0]));
+    return result;
+  };
+
+  std::vector<std::string> vocabulary;
+  std::optional<ZipfDistribution> popularity;
+  if (options.name_skew > 0) {
+    vocabulary.resize(options.vocabulary_size);
+    for (auto& entry : vocabulary) {
+      entry = word();
+    }
+    popularity.emplace(vocabulary.size(), options.name_skew);
+  }
+  auto nameWord = [&] {
+    return popularity ? vocabulary[(*popularity)(gen)] : word();
+  };
+
+  std::uniform_int_distribution<int> phoneCount(0, 2);
+  std::uniform_int_distribution<uint64_t> digits(0, 9'999'999'999ULL);
+  std::bernoulli_distribution hasBirthday(options.birthday_share);
+  std::uniform_int_distribution<int> year(1940, 2010), month(1, 12), day(1, 28);
+
+  PhoneBook::Contacts contacts(count);
+  for (auto& contact : contacts) {
+    contact.name = nameWord() + ' ' + nameWord();
+    if (hasBirthday(gen)) {
+      contact.birthday = Date{year(gen), month(gen), day(gen)};
+    }
+    for (int i = phoneCount(gen); i > 0; --i) {
+      contact.phones.push_back("+7" + std::to_string(digits(gen)));
+    }
+  }
+  return contacts;
+}
+
+// Префиксы случайной длины у имён случайных контактов
+inline std::vector<std::string> GeneratePrefixes(const PhoneBook::Contacts& contacts, size_t count, std::mt19937& gen) {
+  std::uniform_int_distribution<size_t> contact(0, contacts.size() - 1);
+  std::vector<std::string> prefixes(count);
+  for (auto& prefix : prefixes) {
+    const auto& name = contacts[contact(gen)].name;
+    prefix = name.substr(0, std::uniform_int_distribution<size_t>(1, name.size())(gen));
+  }
+  return prefixes;
+}
@@ -0,0 +1,44 @@
+#include "allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+#include <malloc.h>
+
+using namespace std;
+
+atomic<uint64_t> allocationCount = 0;
+atomic<uint64_t> allocatedBytes = 0;
+atomic<uint64_t> liveHeapBytes = 0;
+atomic<uint64_t> peakHeapBytes = 0;
+
+void* operator new(size_t size) {
+  void* p = malloc(size ? size : 1);
+  if (!p) {
+    throw bad_alloc();
+  }
+  allocationCount.fetch_add(1, memory_order_relaxed);
+  allocatedBytes.fetch_add(size, memory_order_relaxed);
+  auto live = liveHeapBytes.fetch_add(malloc_usable_size(p), memory_order_relaxed) + malloc_usable_size(p);
+  auto peak = peakHeapBytes.load(memory_order_relaxed);
+  while (live > peak && !peakHeapBytes.compare_exchange_weak(peak, live, memory_order_relaxed)) {
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  if (p) {
+    liveHeapBytes.fetch_sub(malloc_usable_size(p), memory_order_relaxed);
+  }
+  free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  operator delete(p);
+}
+
+uint64_t ResetHeapPeak() {
+  auto live = liveHeapBytes.load();
+  peakHeapBytes.store(live);
+  return live;
+}
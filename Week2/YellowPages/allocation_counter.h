@@ -0,0 +1,35 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Счётчики выделений из кучи для бенчмарков: allocation_counter.cpp заменяет
+// глобальные operator new/delete, так что его нужно собрать в исполняемый файл.
+// Живые байты считаются по malloc_usable_size, то есть с округлением malloc.
+extern std::atomic<uint64_t> allocationCount;
+extern std::atomic<uint64_t> allocatedBytes;
+extern std::atomic<uint64_t> liveHeapBytes;
+extern std::atomic<uint64_t> peakHeapBytes;
+
+// Опускает пик живой памяти кучи до текущего объёма и возвращает этот объём
+uint64_t ResetHeapPeak();
+
+// Выделения с момента создания. Создание сбрасывает пик, поэтому вложенные
+// счётчики портят PeakBytes внешних.
+struct AllocationCounter {
+  uint64_t count = allocationCount.load();
+  uint64_t bytes = allocatedBytes.load();
+  uint64_t live = ResetHeapPeak();
+
+  uint64_t Count() const {
+    return allocationCount.load() - count;
+  }
+  uint64_t Bytes() const {
+    return allocatedBytes.load() - bytes;
+  }
+  // Наибольший прирост живой памяти кучи с момента создания
+  uint64_t PeakBytes() const {
+    auto peak = peakHeapBytes.load();
+    return peak > live ? peak - live : 0;
+  }
+};
@@ -0,0 +1,193 @@
+#include "batch_merge.h"
+
+#include <algorithm>
+#include <span>
+
+using namespace std;
+
+namespace YellowPages {
+  BatchMerger::BatchMerger(const Providers& providers, Sink sink, Options options)
+    : priorities_(providers)
+    , sink_(move(sink))
+    , options_(options)
+  {
+    options_.thread_count = max<size_t>(options_.thread_count, 1);
+    if (options_.max_queued_batches == 0) {
+      options_.max_queued_batches = 2 * options_.thread_count;
+    }
+    for (size_t i = 0; i < options_.thread_count; ++i) {
+      workers_.emplace_back([this] { Work(); });
+    }
+  }
+
+  BatchMerger::BatchMerger(const Providers& providers, Sink sink)
+    : BatchMerger(providers, move(sink), Options())
+  {}
+
+  BatchMerger::~BatchMerger() {
+    try {
+      Finish();
+    } catch (...) {
+      // Ошибку может получить только тот, кто вызвал Finish сам
+    }
+  }
+
+  void BatchMerger::Add(uint64_t company_id, const Signal& signal) {
+    NewSignal(company_id).CopyFrom(signal);
+  }
+
+  Signal& BatchMerger::NewSignal(uint64_t company_id) {
+    if (pending_.company_ids.empty() || pending_.company_ids.back() != company_id) {
+      if (pending_.signals.size() >= options_.batch_size) {
+        Submit();
+      }
+      if (!pending_.company_ids.empty()) {
+        pending_.bounds.push_back(pending_.signals.size());
+      }
+      pending_.company_ids.push_back(company_id);
+    }
+    if (!pending_.arena) {
+      pending_.arena = TakeArena();
+    }
+    auto signal = google::protobuf::Arena::CreateMessage<Signal>(pending_.arena.get());
+    pending_.signals.push_back(signal);
+    return *signal;
+  }
+
+  unique_ptr<google::protobuf::Arena> BatchMerger::TakeArena() {
+    {
+      lock_guard lock(queue_mutex_);
+      if (!free_arenas_.empty()) {
+        auto arena = move(free_arenas_.back());
+        free_arenas_.pop_back();
+        return arena;
+      }
+    }
+    google::protobuf::ArenaOptions arenaOptions;
+    arenaOptions.start_block_size = options_.arena_block_size;
+    arenaOptions.max_block_size = max(options_.arena_block_size, arenaOptions.max_block_size);
+    return make_unique<google::protobuf::Arena>(arenaOptions);
+  }
+
+  void BatchMerger::ReturnArena(unique_ptr<google::protobuf::Arena> arena) {
+    arena->Reset();
+    lock_guard lock(queue_mutex_);
+    free_arenas_.push_back(move(arena));
+  }
+
+  void BatchMerger::Submit() {
+    if (pending_.company_ids.empty()) {
+      return;
+    }
+    pending_.bounds.push_back(pending_.signals.size());
+    pending_.sequence = next_sequence_++;
+    {
+      unique_lock lock(queue_mutex_);
+      queue_not_full_.wait(lock, [this] { return queue_.size() < options_.max_queued_batches; });
+      queue_.push_back(move(pending_));
+    }
+    queue_not_empty_.notify_one();
+    pending_ = Batch();
+  }
+
+  void BatchMerger::Finish() {
+    if (finished_) {
+      return;
+    }
+    finished_ = true;
+    Submit();
+    {
+      lock_guard lock(queue_mutex_);
+      closed_ = true;
+    }
+    queue_not_empty_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+
+    lock_guard lock(emit_mutex_);
+    if (error_) {
+      rethrow_exception(error_);
+    }
+  }
+
+  BatchMerger::Stats BatchMerger::GetStats() const {
+    lock_guard lock(emit_mutex_);
+    return stats_;
+  }
+
+  void BatchMerger::Work() {
+    vector<Company*> companies;
+    while (true) {
+      Batch batch;
+      {
+        unique_lock lock(queue_mutex_);
+        queue_not_empty_.wait(lock, [this] { return !queue_.empty() || closed_; });
+        if (queue_.empty()) {
+          return;
+        }
+        batch = move(queue_.front());
+        queue_.pop_front();
+      }
+      queue_not_full_.notify_one();
+
+      companies.clear();
+      bool failed;
+      {
+        lock_guard lock(emit_mutex_);
+        failed = static_cast<bool>(error_);
+      }
+      // После ошибки пакеты не сливаются, а только отмечаются выданными
+      if (!failed) {
+        try {
+          span<const Signal* const> signals(batch.signals);
+          for (size_t i = 0; i < batch.company_ids.size(); ++i) {
+            auto& company = *google::protobuf::Arena::CreateMessage<Company>(batch.arena.get());
+            Merge(signals.subspan(batch.bounds[i], batch.bounds[i + 1] - batch.bounds[i]), priorities_, company);
+            companies.push_back(&company);
+          }
+        } catch (...) {
+          lock_guard lock(emit_mutex_);
+          if (!error_) {
+            error_ = current_exception();
+          }
+        }
+      }
+      Emit(batch, companies);
+      companies.clear();
+      ReturnArena(move(batch.arena));
+    }
+  }
+
+  void BatchMerger::Emit(const Batch& batch, const vector<Company*>& companies) {
+    unique_lock lock(emit_mutex_);
+    emit_turn_.wait(lock, [&] { return emitted_ == batch.sequence; });
+    if (!error_) {
+      // Пока не выдан этот пакет, очередь дальше не двигается, так что sink
+      // по-прежнему вызывается по одному, но уже без блокировки: из него можно
+      // звать GetStats
+      lock.unlock();
+      exception_ptr error;
+      try {
+        for (size_t i = 0; i < companies.size(); ++i) {
+          sink_(batch.company_ids[i], *companies[i]);
+        }
+      } catch (...) {
+        error = current_exception();
+      }
+      lock.lock();
+      if (error) {
+        if (!error_) {
+          error_ = error;
+        }
+      } else {
+        stats_.companies += companies.size();
+        stats_.signals += batch.signals.size();
+        ++stats_.batches;
+        stats_.arena_bytes += batch.arena->SpaceAllocated();
+      }
+    }
+    ++emitted_;
+    emit_turn_.notify_all();
+  }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "yellow_pages.h"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <google/protobuf/arena.h>
+
+namespace YellowPages {
+  // Слияние потока записей (ключ организации, сигнал) для множества организаций.
+  // Записи одной организации должны идти подряд, как после сортировки по ключу.
+  // Поступающие записи режутся на пакеты по целым организациям, пакеты сливаются
+  // параллельно, а результаты отдаются в sink по порядку поступления организаций.
+  //
+  // Память ограничена: Add ждёт, пока в очереди больше max_queued_batches пакетов.
+  // У каждого пакета своя арена protobuf: на ней лежат и входные сигналы, и
+  // результаты слияния, а после выдачи пакета арена очищается целиком и идёт под
+  // следующий пакет. Поэтому Company, переданная в sink, живёт только до его возврата.
+  class BatchMerger {
+  public:
+    struct Options {
+      size_t thread_count = std::thread::hardware_concurrency();
+      // Сигналов в пакете; организация в пакете не делится, так что пакет
+      // может оказаться больше
+      size_t batch_size = 1 << 14;
+      // 0 — вдвое больше числа потоков
+      size_t max_queued_batches = 0;
+      // Размер первого блока арены пакета
+      size_t arena_block_size = 1 << 20;
+    };
+
+    struct Stats {
+      uint64_t companies = 0;
+      uint64_t signals = 0;
+      uint64_t batches = 0;
+      // Сколько байт заняли арены выданных пакетов
+      uint64_t arena_bytes = 0;
+    };
+
+    // Вызывается из рабочих потоков, но никогда одновременно и без блокировок
+    // BatchMerger, так что из sink можно звать GetStats
+    using Sink = std::function<void(uint64_t company_id, const Company& company)>;
+
+    BatchMerger(const Providers& providers, Sink sink, Options options);
+    BatchMerger(const Providers& providers, Sink sink);
+    ~BatchMerger();
+
+    BatchMerger(const BatchMerger&) = delete;
+    BatchMerger& operator=(const BatchMerger&) = delete;
+
+    // Копирует сигнал на арену текущего пакета
+    void Add(uint64_t company_id, const Signal& signal);
+
+    // Пустой сигнал организации company_id прямо на арене текущего пакета, без
+    // копирования. Заполнить его нужно до следующего вызова Add, NewSignal или Finish.
+    Signal& NewSignal(uint64_t company_id);
+
+    // Дожидается слияния всех записей. Исключение из слияния или из sink
+    // пробрасывается отсюда; после первой ошибки остальные пакеты пропускаются.
+    void Finish();
+
+    Stats GetStats() const;
+
+  private:
+    struct Batch {
+      uint64_t sequence = 0;
+      std::unique_ptr<google::protobuf::Arena> arena;
+      std::vector<uint64_t> company_ids;
+      // Организация i занимает сигналы [bounds[i], bounds[i + 1])
+      std::vector<size_t> bounds = {0};
+      std::vector<const Signal*> signals;
+    };
+
+    void Submit();
+    std::unique_ptr<google::protobuf::Arena> TakeArena();
+    void ReturnArena(std::unique_ptr<google::protobuf::Arena> arena);
+    void Work();
+    void Emit(const Batch& batch, const std::vector<Company*>& companies);
+
+    ProviderPriorities priorities_;
+    Sink sink_;
+    Options options_;
+
+    Batch pending_;
+    uint64_t next_sequence_ = 0;
+    bool finished_ = false;
+
+    std::mutex queue_mutex_;
+    std::condition_variable queue_not_empty_, queue_not_full_;
+    std::deque<Batch> queue_;
+    bool closed_ = false;
+    // Очищенные арены обработанных пакетов
+    std::vector<std::unique_ptr<google::protobuf::Arena>> free_arenas_;
+
+    // Пакеты выдаются строго по номерам
+    mutable std::mutex emit_mutex_;
+    std::condition_variable emit_turn_;
+    uint64_t emitted_ = 0;
+    std::exception_ptr error_;
+    Stats stats_;
+
+    std::vector<std::thread> workers_;
+  };
+}
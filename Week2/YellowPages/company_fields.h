@@ -0,0 +1,46 @@
+#pragma once
+
+#include "company.pb.h"
+
+namespace YellowPages {
+  // Поля Company, которые сливаются через типизированные методы доступа.
+  // Has/Get/Mutable/Clear повторяют сгенерированные has_*, *, mutable_* и clear_*.
+  struct AddressField {
+    static constexpr int Number = Company::kAddressFieldNumber;
+    static bool Has(const Company& company) { return company.has_address(); }
+    static const Address& Get(const Company& company) { return company.address(); }
+    static Address* Mutable(Company& company) { return company.mutable_address(); }
+    static void Clear(Company& company) { company.clear_address(); }
+  };
+
+  struct WorkingTimeField {
+    static constexpr int Number = Company::kWorkingTimeFieldNumber;
+    static bool Has(const Company& company) { return company.has_working_time(); }
+    static const WorkingTime& Get(const Company& company) { return company.working_time(); }
+    static WorkingTime* Mutable(Company& company) { return company.mutable_working_time(); }
+    static void Clear(Company& company) { company.clear_working_time(); }
+  };
+
+  struct NamesField {
+    static constexpr int Number = Company::kNamesFieldNumber;
+    static const auto& Get(const Company& company) { return company.names(); }
+    static auto* Mutable(Company& company) { return company.mutable_names(); }
+  };
+
+  struct PhonesField {
+    static constexpr int Number = Company::kPhonesFieldNumber;
+    static const auto& Get(const Company& company) { return company.phones(); }
+    static auto* Mutable(Company& company) { return company.mutable_phones(); }
+  };
+
+  struct UrlsField {
+    static constexpr int Number = Company::kUrlsFieldNumber;
+    static const auto& Get(const Company& company) { return company.urls(); }
+    static auto* Mutable(Company& company) { return company.mutable_urls(); }
+  };
+
+  constexpr int KnownFieldNumbers[] = {
+    AddressField::Number, WorkingTimeField::Number,
+    NamesField::Number, PhonesField::Number, UrlsField::Number,
+  };
+}
@@ -0,0 +1,362 @@
+#include "company_store.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace CompanyStoreFormat {
+  constexpr char Magic[8] = {'C', 'O', 'M', 'P', 'S', 'S', 'T', '\0'};
+  constexpr uint32_t ByteOrderMark = 0x01020304;
+  constexpr uint32_t Version = 2;
+
+  // Запись: RecordHeader и сразу за ним size байт Company, без выравнивания
+  struct RecordHeader {
+    uint64_t company_id;
+    uint32_t size;
+  } __attribute__((packed));
+
+  struct IndexEntry {
+    uint64_t company_id;
+    uint64_t offset;
+  };
+
+  // Последние байты шарда. Индекс и фильтр выровнены на 8 байт.
+  struct Footer {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t version;
+    uint64_t shard;
+    uint64_t shard_count;
+    // Общий для всех шардов одной записи хранилища
+    uint64_t generation;
+    uint64_t record_count;
+    uint64_t records_size;
+    uint64_t index_offset;
+    uint64_t index_count;
+    uint64_t bloom_offset;
+    uint64_t bloom_words;
+    uint64_t bloom_hash_count;
+  };
+
+  size_t Align(size_t offset) {
+    return (offset + 7) & ~size_t(7);
+  }
+
+  // splitmix64: шард и фильтр Блума берут независимые хеши ключа
+  uint64_t Mix(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+  }
+
+  size_t ShardOf(uint64_t company_id, size_t shard_count) {
+    return Mix(company_id) % shard_count;
+  }
+
+  // Двойное хеширование: i-й бит — h1 + i * h2
+  template <class Visit>
+  void ForEachBloomBit(uint64_t company_id, uint64_t words, uint64_t hash_count, Visit visit) {
+    uint64_t hash = Mix(company_id ^ 0xA0761D6478BD642FULL);
+    uint64_t h1 = hash, h2 = (hash >> 32) | 1;
+    for (uint64_t i = 0; i < hash_count; ++i) {
+      uint64_t bit = (h1 + i * h2) % (words * 64);
+      if (!visit(bit / 64, uint64_t(1) << (bit % 64))) {
+        return;
+      }
+    }
+  }
+
+  string ShardPath(const string& directory, size_t shard) {
+    char name[32];
+    snprintf(name, sizeof(name), "shard-%05zu.sst", shard);
+    return (filesystem::path(directory) / name).string();
+  }
+
+  // Шард пишется рядом и подменяет прежний переименованием: у тех, кто держит
+  // прежний шард отображённым, остаётся старый файл, а не обрезанный
+  string TemporaryPath(const string& directory, size_t shard) {
+    return ShardPath(directory, shard) + ".tmp";
+  }
+}
+
+using namespace CompanyStoreFormat;
+
+namespace YellowPages {
+  namespace {
+    void WritePadding(ostream& output, uint64_t& size) {
+      static const char zeros[8] = {};
+      output.write(zeros, Align(size) - size);
+      size = Align(size);
+    }
+  }
+
+  CompanyStoreWriter::CompanyStoreWriter(const string& directory, Options options)
+    : directory_(directory)
+    , options_(options)
+  {
+    options_.shard_count = max<size_t>(options_.shard_count, 1);
+    options_.index_interval = max<size_t>(options_.index_interval, 1);
+    options_.bloom_bits_per_key = max<size_t>(options_.bloom_bits_per_key, 1);
+    random_device entropy;
+    generation_ = (uint64_t(entropy()) << 32) ^ entropy();
+    filesystem::create_directories(directory_);
+    shards_.resize(options_.shard_count);
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      auto path = TemporaryPath(directory_, i);
+      shards_[i].output.open(path, ios::binary | ios::trunc);
+      if (!shards_[i].output) {
+        throw runtime_error("Cannot create " + path);
+      }
+    }
+  }
+
+  CompanyStoreWriter::CompanyStoreWriter(const string& directory)
+    : CompanyStoreWriter(directory, Options())
+  {}
+
+  CompanyStoreWriter::~CompanyStoreWriter() {
+    try {
+      Finish();
+    } catch (...) {
+      // Ошибку может получить только тот, кто вызвал Finish сам
+    }
+  }
+
+  void CompanyStoreWriter::Add(uint64_t company_id, const Company& company) {
+    if (last_id_ && *last_id_ >= company_id) {
+      throw invalid_argument("Company ids must be added in increasing order");
+    }
+    last_id_ = company_id;
+
+    auto& shard = shards_[ShardOf(company_id, shards_.size())];
+    if (shard.ids.size() % options_.index_interval == 0) {
+      shard.index.push_back({company_id, shard.size});
+    }
+    shard.ids.push_back(company_id);
+
+    company.SerializeToString(&buffer_);
+    RecordHeader header{company_id, static_cast<uint32_t>(buffer_.size())};
+    shard.output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    shard.output.write(buffer_.data(), buffer_.size());
+    shard.size += sizeof(header) + buffer_.size();
+  }
+
+  void CompanyStoreWriter::Finish() {
+    if (finished_) {
+      return;
+    }
+    finished_ = true;
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      FinishShard(i);
+    }
+    // Нулевой шард, по которому Open узнаёт число шардов, подменяется последним
+    for (size_t i = shards_.size(); i-- > 0;) {
+      filesystem::rename(TemporaryPath(directory_, i), ShardPath(directory_, i));
+    }
+    // Шарды прежней записи с большим их числом
+    for (size_t i = shards_.size(); filesystem::remove(ShardPath(directory_, i)); ++i) {
+    }
+  }
+
+  void CompanyStoreWriter::FinishShard(size_t index) {
+    auto& shard = shards_[index];
+    Footer footer{};
+    memcpy(footer.magic, Magic, sizeof(Magic));
+    footer.byte_order = ByteOrderMark;
+    footer.version = Version;
+    footer.shard = index;
+    footer.shard_count = shards_.size();
+    footer.generation = generation_;
+    footer.record_count = shard.ids.size();
+    footer.records_size = shard.size;
+
+    WritePadding(shard.output, shard.size);
+    footer.index_offset = shard.size;
+    footer.index_count = shard.index.size();
+    shard.output.write(reinterpret_cast<const char*>(shard.index.data()), shard.index.size() * sizeof(IndexEntry));
+    shard.size += shard.index.size() * sizeof(IndexEntry);
+
+    // k = ln 2 * бит на ключ даёт наименьшую долю ложных срабатываний
+    footer.bloom_words = max<uint64_t>(1, (shard.ids.size() * options_.bloom_bits_per_key + 63) / 64);
+    footer.bloom_hash_count = max<uint64_t>(1, options_.bloom_bits_per_key * 69 / 100);
+    vector<uint64_t> bloom(footer.bloom_words);
+    for (uint64_t id : shard.ids) {
+      ForEachBloomBit(id, footer.bloom_words, footer.bloom_hash_count, [&bloom](uint64_t word, uint64_t mask) {
+        bloom[word] |= mask;
+        return true;
+      });
+    }
+    footer.bloom_offset = shard.size;
+    shard.output.write(reinterpret_cast<const char*>(bloom.data()), bloom.size() * sizeof(uint64_t));
+    shard.size += bloom.size() * sizeof(uint64_t);
+
+    shard.output.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+    shard.output.close();
+    if (!shard.output) {
+      throw runtime_error("Cannot write " + TemporaryPath(directory_, index));
+    }
+    shard.ids = {};
+    shard.index = {};
+  }
+
+  CompanyStore::Shard CompanyStore::MapShard(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw runtime_error("Cannot open " + path);
+    }
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+      close(fd);
+      throw runtime_error("Cannot map " + path);
+    }
+    auto size = static_cast<size_t>(info.st_size);
+    void* address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) {
+      throw runtime_error("Cannot map " + path);
+    }
+
+    Shard shard;
+    shard.storage = shared_ptr<const void>(address, [size](const void* p) {
+      munmap(const_cast<void*>(p), size);
+    });
+    shard.data = string_view(static_cast<const char*>(address), size);
+
+    if (size < sizeof(Footer)) {
+      throw runtime_error("Company store shard is truncated: " + path);
+    }
+    auto footer = reinterpret_cast<const Footer*>(shard.data.data() + size - sizeof(Footer));
+    if (memcmp(footer->magic, Magic, sizeof(Magic)) != 0) {
+      throw runtime_error("Not a company store shard: " + path);
+    }
+    if (footer->byte_order != ByteOrderMark) {
+      throw runtime_error("Company store shard has foreign byte order: " + path);
+    }
+    if (footer->version != Version) {
+      throw runtime_error("Unsupported company store shard version: " + path);
+    }
+    if (footer->shard_count == 0 || footer->shard >= footer->shard_count) {
+      throw runtime_error("Company store shard has invalid shard number: " + path);
+    }
+    // Секция из count элементов по offset умещается до заголовка; вычитание
+    // вместо сложения, чтобы испорченные числа не переполнялись
+    uint64_t dataEnd = size - sizeof(Footer);
+    auto fits = [dataEnd](uint64_t offset, uint64_t count, uint64_t itemSize) {
+      return offset <= dataEnd && count <= (dataEnd - offset) / itemSize;
+    };
+    if (footer->records_size > footer->index_offset
+        || !fits(footer->index_offset, footer->index_count, sizeof(IndexEntry))
+        || footer->index_offset + footer->index_count * sizeof(IndexEntry) > footer->bloom_offset
+        || !fits(footer->bloom_offset, footer->bloom_words, sizeof(uint64_t))
+        || footer->bloom_offset + footer->bloom_words * sizeof(uint64_t) != dataEnd
+        || footer->index_offset % 8 != 0 || footer->bloom_offset % 8 != 0 || footer->bloom_words == 0) {
+      throw runtime_error("Company store shard sections are corrupted: " + path);
+    }
+    shard.footer = footer;
+    shard.records_size = footer->records_size;
+    shard.index = reinterpret_cast<const IndexEntry*>(shard.data.data() + footer->index_offset);
+    shard.bloom = reinterpret_cast<const uint64_t*>(shard.data.data() + footer->bloom_offset);
+    return shard;
+  }
+
+  CompanyStore CompanyStore::Open(const string& directory) {
+    CompanyStore store;
+    store.shards_.push_back(MapShard(ShardPath(directory, 0)));
+    size_t shardCount = store.shards_.front().footer->shard_count;
+    for (size_t i = 1; i < shardCount; ++i) {
+      store.shards_.push_back(MapShard(ShardPath(directory, i)));
+    }
+    for (size_t i = 0; i < shardCount; ++i) {
+      const auto& footer = *store.shards_[i].footer;
+      if (footer.shard != i || footer.shard_count != shardCount
+          || footer.generation != store.shards_.front().footer->generation) {
+        throw runtime_error("Company store shards belong to different stores: " + directory);
+      }
+      store.size_ += footer.record_count;
+    }
+    return store;
+  }
+
+  bool CompanyStore::MayContain(const Shard& shard, uint64_t company_id) {
+    bool result = true;
+    ForEachBloomBit(company_id, shard.footer->bloom_words, shard.footer->bloom_hash_count,
+                    [&](uint64_t word, uint64_t mask) {
+                      result = (shard.bloom[word] & mask) != 0;
+                      return result;
+                    });
+    return result;
+  }
+
+  optional<string_view> CompanyStore::FindSerialized(uint64_t company_id) const {
+    const auto& shard = shards_[ShardOf(company_id, shards_.size())];
+    if (!MayContain(shard, company_id)) {
+      return nullopt;
+    }
+
+    // Последняя запись индекса с ключом не больше искомого; от неё — не больше
+    // index_interval записей до следующей
+    auto indexEnd = shard.index + shard.footer->index_count;
+    auto next = upper_bound(shard.index, indexEnd, company_id, [](uint64_t id, const IndexEntry& entry) {
+      return id < entry.company_id;
+    });
+    if (next == shard.index) {
+      return nullopt;
+    }
+    size_t offset = prev(next)->offset;
+    size_t end = next == indexEnd ? shard.records_size : next->offset;
+    if (end > shard.records_size) {
+      throw runtime_error("Company store index is corrupted");
+    }
+
+    while (offset < end) {
+      if (end - offset < sizeof(RecordHeader)) {
+        throw runtime_error("Company store record is truncated");
+      }
+      RecordHeader header;
+      memcpy(&header, shard.data.data() + offset, sizeof(header));
+      offset += sizeof(header);
+      if (end - offset < header.size) {
+        throw runtime_error("Company store record is truncated");
+      }
+      if (header.company_id == company_id) {
+        return shard.data.substr(offset, header.size);
+      }
+      if (header.company_id > company_id) {
+        break;
+      }
+      offset += header.size;
+    }
+    return nullopt;
+  }
+
+  optional<Company> CompanyStore::Find(uint64_t company_id) const {
+    auto serialized = FindSerialized(company_id);
+    if (!serialized) {
+      return nullopt;
+    }
+    Company company;
+    if (!company.ParseFromArray(serialized->data(), static_cast<int>(serialized->size()))) {
+      throw runtime_error("Company store record is corrupted");
+    }
+    return company;
+  }
+
+  size_t CompanyStore::size() const {
+    return size_;
+  }
+
+  size_t CompanyStore::ShardCount() const {
+    return shards_.size();
+  }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "company.pb.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CompanyStoreFormat {
+  struct Footer;
+  struct IndexEntry;
+}
+
+namespace YellowPages {
+  // Хранилище слитых организаций для точечных запросов по ключу организации.
+  // Организации раскладываются по шардам по хешу ключа; шард — файл
+  // shard-NNNNN.sst в каталоге хранилища, как SSTable:
+  //   записи (ключ, длина, сериализованная Company), отсортированные по ключу;
+  //   разреженный индекс — ключ и смещение каждой index_interval-й записи;
+  //   фильтр Блума по ключам, чтобы отвечать «нет» без чтения записей;
+  //   заголовок в конце файла со смещениями секций.
+  // Числа хранятся в порядке байт машины, на которой хранилище было записано.
+
+  class CompanyStoreWriter {
+  public:
+    struct Options {
+      size_t shard_count = 16;
+      // Записей на одну запись разреженного индекса
+      size_t index_interval = 64;
+      // Бит фильтра Блума на ключ; 10 дают около 1% ложных срабатываний
+      size_t bloom_bits_per_key = 10;
+    };
+
+    // Создаёт каталог, если его нет. Шарды пишутся во временные файлы, а Finish
+    // подменяет ими прежние и удаляет лишние, так что открытое хранилище
+    // продолжает работать со старыми данными.
+    CompanyStoreWriter(const std::string& directory, Options options);
+    explicit CompanyStoreWriter(const std::string& directory);
+    ~CompanyStoreWriter();
+
+    CompanyStoreWriter(const CompanyStoreWriter&) = delete;
+    CompanyStoreWriter& operator=(const CompanyStoreWriter&) = delete;
+
+    // Ключи должны строго возрастать, как в выдаче BatchMerger по отсортированному
+    // входу; иначе — std::invalid_argument
+    void Add(uint64_t company_id, const Company& company);
+
+    // Дописывает индексы, фильтры и заголовки шардов. Без вызова Finish
+    // хранилище дописывает деструктор, но ошибки записи тогда теряются.
+    void Finish();
+
+  private:
+    struct Shard {
+      std::ofstream output;
+      uint64_t size = 0;
+      std::vector<uint64_t> ids;
+      std::vector<CompanyStoreFormat::IndexEntry> index;
+    };
+
+    void FinishShard(size_t shard);
+
+    std::string directory_;
+    Options options_;
+    std::vector<Shard> shards_;
+    // Случайный номер этой записи; Open не смешивает шарды разных записей
+    uint64_t generation_;
+    std::optional<uint64_t> last_id_;
+    std::string buffer_;
+    bool finished_ = false;
+  };
+
+  // Отображённое в память хранилище. Поиск не меняет состояния, так что им можно
+  // пользоваться из нескольких потоков сразу.
+  class CompanyStore {
+  public:
+    // Отображает шарды каталога в память; бросает std::runtime_error, если
+    // шарда нет, он повреждён или шарды от разных записей — например, Open
+    // застал перезапись посередине и его стоит повторить
+    static CompanyStore Open(const std::string& directory);
+
+    // Сериализованная Company — например, чтобы отдать клиенту без разбора.
+    // string_view указывает в отображение и живёт, пока живо хранилище.
+    std::optional<std::string_view> FindSerialized(uint64_t company_id) const;
+    std::optional<Company> Find(uint64_t company_id) const;
+
+    size_t size() const;
+    size_t ShardCount() const;
+
+  private:
+    struct Shard {
+      // Владеет отображением, на которое указывает data
+      std::shared_ptr<const void> storage;
+      std::string_view data;
+      const CompanyStoreFormat::Footer* footer;
+      // Записи занимают data.substr(0, records_size)
+      size_t records_size;
+      const CompanyStoreFormat::IndexEntry* index;
+      const uint64_t* bloom;
+    };
+
+    static Shard MapShard(const std::string& path);
+    static bool MayContain(const Shard& shard, uint64_t company_id);
+
+    std::vector<Shard> shards_;
+    size_t size_ = 0;
+  };
+}
@@ -1,65 +1,321 @@
 #include "yellow_pages.h"
+#include "company_fields.h"
+#include "message_hash.h"
 
 #include <algorithm>
-#include <tuple>
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <string>
-#include <limits>
+#include <unordered_set>
 
 using namespace std;
 
 namespace YellowPages {
-  void MergeValue(string field, const Signals& signals, const Providers& providers, Company& company) {
-    auto fieldDescriptor = company.GetDescriptor()->FindFieldByName(field);
-    auto reflection = company.GetReflection();
-    string serializedField;
-    int priority = numeric_limits<uint64_t>::min();
-    for (auto& signal : signals) {
-      if (!signal.has_company()) continue;
-      if (!reflection->HasField(signal.company(), fieldDescriptor)) continue;
-      auto curPriority = providers.at(signal.provider_id()).priority();
-      if (priority > curPriority) continue;
-      priority = curPriority;
+  namespace {
+    using google::protobuf::FieldDescriptor;
+    using google::protobuf::Message;
+
+    constexpr uint64_t UnknownPriority = UINT64_MAX;
 
-      serializedField = reflection->GetMessage(signal.company(), fieldDescriptor).SerializeAsString();
+    // Сигналы передаются и массивом, и указателями на сигналы, лежащие на арене
+    const Signal& AsSignal(const Signal& signal) {
+      return signal;
     }
-    if (serializedField.empty()) return;
-    reflection->MutableMessage(&company, fieldDescriptor)->ParseFromString(serializedField);
-  }
 
-  void MergeRepValue(string field, const Signals& signals, const Providers& providers, Company& company) {
-    auto fieldDescriptor = company.GetDescriptor()->FindFieldByName(field);
-    auto reflection = company.GetReflection();
-    unordered_set<string> serializedFields;
-    int priority = numeric_limits<uint64_t>::min();
-    for (auto& signal : signals) {
-      if (!signal.has_company()) continue;
-      auto size = reflection->FieldSize(signal.company(), fieldDescriptor);
-      if (size == 0) continue;
-      auto curPriority = providers.at(signal.provider_id()).priority();
-      if (curPriority < priority) continue;
-      if (priority < curPriority) {
-        serializedFields.clear();
+    const Signal& AsSignal(const Signal* signal) {
+      return *signal;
+    }
+
+    // Данные сигнала и приоритет его поставщика, найденный один раз на всё слияние
+    struct RankedSignal {
+      const Company* company;
+      uint64_t priority;
+      uint64_t update_date;
+    };
+
+    // Неизвестный поставщик — ошибка, но только если у сигнала есть нужное поле
+    uint32_t Priority(const RankedSignal& signal) {
+      if (signal.priority == UnknownPriority) {
+        throw out_of_range("Unknown provider");
+      }
+      return static_cast<uint32_t>(signal.priority);
+    }
+
+    // Ранг победителя одиночного поля: приоритет, затем дата обновления. При
+    // равных рангах побеждает более поздний по порядку сигнал, так что результат
+    // определяется входом полностью.
+    using Rank = pair<uint32_t, uint64_t>;
+
+    Rank RankOf(const RankedSignal& signal) {
+      return {Priority(signal), signal.update_date};
+    }
+
+    // Память на стеке для временных массивов и множеств слияния; обычно её
+    // хватает, и слияние обходится без обращений к куче
+    using ScratchBuffer = array<byte, 8192>;
+
+    // Слияние одного поля по мере прохода по сигналам: каждый сигнал передаётся
+    // в Add всех полей сразу, так что его данные читаются один раз, пока они в кеше.
+    // Finish записывает итог в пустую company.
+
+    // Сообщения сравниваются и копируются напрямую: победитель запоминается
+    // указателем и копируется в результат один раз. Пустой победитель, как и
+    // раньше, оставляет поле незаданным.
+    template <class Field>
+    class ValueMerger {
+    public:
+      void Add(const RankedSignal& signal) {
+        if (!Field::Has(*signal.company)) return;
+        auto rank = RankOf(signal);
+        if (rank < rank_) return;
+        rank_ = rank;
+        winner_ = &Field::Get(*signal.company);
+      }
+
+      void Finish(Company& company) const {
+        if (!winner_ || winner_->ByteSizeLong() == 0) return;
+        Field::Mutable(company)->CopyFrom(*winner_);
+      }
+
+    private:
+      const Message* winner_ = nullptr;
+      Rank rank_;
+    };
+
+    // Значения сигналов с наибольшим приоритетом без повторов, в порядке первого
+    // появления во входе. Дата обновления порядок не меняет: значения разных
+    // сигналов одного приоритета объединяются.
+    template <class Field>
+    class RepValueMerger {
+      using Value = typename decay_t<decltype(Field::Get(declval<const Company&>()))>::value_type;
+
+    public:
+      explicit RepValueMerger(pmr::memory_resource* scratch)
+        : seen_(scratch)
+        , values_(scratch)
+      {}
+
+      void Add(const RankedSignal& signal) {
+        const auto& signalValues = Field::Get(*signal.company);
+        if (signalValues.empty()) return;
+        auto curPriority = Priority(signal);
+        if (curPriority < priority_) return;
+        if (priority_ < curPriority) {
+          seen_.clear();
+          values_.clear();
+        }
+        priority_ = curPriority;
+        for (const auto& value : signalValues) {
+          if (seen_.insert(&value).second) {
+            values_.push_back(&value);
+          }
+        }
+      }
+
+      void Finish(Company& company) const {
+        auto& result = *Field::Mutable(company);
+        result.Reserve(static_cast<int>(values_.size()));
+        for (auto value : values_) {
+          result.Add()->CopyFrom(*value);
+        }
       }
-      priority = curPriority;
-      for (int i = 0; i < size; ++i) {
-        serializedFields.insert(reflection->GetRepeatedMessage(signal.company(),
-                                                                  fieldDescriptor,
-                                                                  i).SerializeAsString());
+
+    private:
+      pmr::unordered_set<const Value*, MessagePtrHash, MessagePtrEqual> seen_;
+      pmr::vector<const Value*> values_;
+      uint32_t priority_ = 0;
+    };
+
+    // То же для любого поля-сообщения через Reflection
+    class ReflectionMerger {
+    public:
+      ReflectionMerger(const FieldDescriptor* field, pmr::memory_resource* scratch)
+        : field_(field)
+        , seen_(scratch)
+        , values_(scratch)
+      {}
+
+      void Add(const RankedSignal& signal) {
+        auto reflection = signal.company->GetReflection();
+        if (!field_->is_repeated()) {
+          if (!reflection->HasField(*signal.company, field_)) return;
+          auto rank = RankOf(signal);
+          if (rank < rank_) return;
+          rank_ = rank;
+          values_.assign(1, &reflection->GetMessage(*signal.company, field_));
+          return;
+        }
+
+        auto size = reflection->FieldSize(*signal.company, field_);
+        if (size == 0) return;
+        auto curPriority = Priority(signal);
+        if (curPriority < priority_) return;
+        if (priority_ < curPriority) {
+          seen_.clear();
+          values_.clear();
+        }
+        priority_ = curPriority;
+        for (int i = 0; i < size; ++i) {
+          auto value = &reflection->GetRepeatedMessage(*signal.company, field_, i);
+          if (seen_.insert(value).second) {
+            values_.push_back(value);
+          }
+        }
       }
+
+      void Finish(Company& company) const {
+        auto reflection = company.GetReflection();
+        if (!field_->is_repeated()) {
+          if (values_.empty() || values_.front()->ByteSizeLong() == 0) return;
+          reflection->MutableMessage(&company, field_)->CopyFrom(*values_.front());
+          return;
+        }
+        for (auto value : values_) {
+          reflection->AddMessage(&company, field_)->CopyFrom(*value);
+        }
+      }
+
+    private:
+      const FieldDescriptor* field_;
+      pmr::unordered_set<const Message*, MessagePtrHash, MessagePtrEqual> seen_;
+      pmr::vector<const Message*> values_;
+      // Для одиночного поля
+      Rank rank_;
+      // Для повторяющегося
+      uint32_t priority_ = 0;
+    };
+
+    // Поля-сообщения Company, для которых нет типизированного слияния, например
+    // добавленные в company.proto позже. Ищутся один раз.
+    const vector<const FieldDescriptor*>& OtherMessageFields() {
+      static const auto fields = [] {
+        vector<const FieldDescriptor*> result;
+        auto descriptor = Company::descriptor();
+        for (int i = 0; i < descriptor->field_count(); ++i) {
+          auto field = descriptor->field(i);
+          if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE
+              && find(begin(KnownFieldNumbers), end(KnownFieldNumbers), field->number()) == end(KnownFieldNumbers)) {
+            result.push_back(field);
+          }
+        }
+        return result;
+      }();
+      return fields;
     }
-    for (auto& serializedField : serializedFields) {
-      reflection->AddMessage(&company, fieldDescriptor)->ParseFromString(serializedField);
+
+    // Один проход по сигналам: приоритет ищется один раз на сигнал, сигнал
+    // сразу передаётся слиянию каждого поля. priority_of(provider_id) возвращает
+    // optional<uint32_t>. Сигналы без данных об организации пропускаются.
+    template <class SignalRange, class PriorityOf>
+    void MergeFields(const SignalRange& signals, PriorityOf priority_of, Company& company) {
+      ScratchBuffer buffer;
+      pmr::monotonic_buffer_resource scratch(buffer.data(), buffer.size());
+      ValueMerger<WorkingTimeField> workingTime;
+      ValueMerger<AddressField> address;
+      RepValueMerger<NamesField> names(&scratch);
+      RepValueMerger<PhonesField> phones(&scratch);
+      RepValueMerger<UrlsField> urls(&scratch);
+      pmr::vector<ReflectionMerger> others(&scratch);
+      for (auto field : OtherMessageFields()) {
+        others.emplace_back(field, &scratch);
+      }
+
+      for (auto& item : signals) {
+        const Signal& signal = AsSignal(item);
+        if (!signal.has_company()) continue;
+        auto priority = priority_of(signal.provider_id());
+        RankedSignal ranked{&signal.company(), priority ? *priority : UnknownPriority, signal.update_date()};
+        workingTime.Add(ranked);
+        address.Add(ranked);
+        names.Add(ranked);
+        phones.Add(ranked);
+        urls.Add(ranked);
+        for (auto& other : others) {
+          other.Add(ranked);
+        }
+      }
+
+      workingTime.Finish(company);
+      address.Finish(company);
+      names.Finish(company);
+      phones.Finish(company);
+      urls.Finish(company);
+      for (const auto& other : others) {
+        other.Finish(company);
+      }
+    }
+
+    auto FindIn(const Providers& providers) {
+      return [&providers](uint64_t provider_id) -> optional<uint32_t> {
+        auto it = providers.find(provider_id);
+        if (it == providers.end()) {
+          return nullopt;
+        }
+        return it->second.priority();
+      };
+    }
+
+    auto FindIn(const ProviderPriorities& priorities) {
+      return [&priorities](uint64_t provider_id) {
+        return priorities.Find(provider_id);
+      };
     }
   }
 
   Company Merge(const Signals& signals, const Providers& providers) {
     Company company;
-    MergeValue("working_time", signals, providers, company);
-    MergeValue("address", signals, providers, company);
-    MergeRepValue("names", signals, providers, company);
-    MergeRepValue("phones", signals, providers, company);
-    MergeRepValue("urls", signals, providers, company);
+    Merge(signals, providers, company);
+    return company;
+  }
+
+  Company Merge(const Signals& signals, const ProviderPriorities& priorities) {
+    Company company;
+    Merge(signals, priorities, company);
+    return company;
+  }
+
+  void Merge(span<const Signal> signals, const Providers& providers, Company& company) {
+    MergeFields(signals, FindIn(providers), company);
+  }
+
+  void Merge(span<const Signal> signals, const ProviderPriorities& priorities, Company& company) {
+    MergeFields(signals, FindIn(priorities), company);
+  }
+
+  void Merge(span<const Signal* const> signals, const ProviderPriorities& priorities, Company& company) {
+    MergeFields(signals, FindIn(priorities), company);
+  }
+
+  Company MergeWithReflection(const Signals& signals, const Providers& providers) {
+    ScratchBuffer buffer;
+    pmr::monotonic_buffer_resource scratch(buffer.data(), buffer.size());
+    pmr::vector<ReflectionMerger> fields(&scratch);
+    auto descriptor = Company::descriptor();
+    for (auto name : {"working_time", "address", "names", "phones", "urls"}) {
+      fields.emplace_back(descriptor->FindFieldByName(name), &scratch);
+    }
+
+    auto priority_of = FindIn(providers);
+    for (const auto& signal : signals) {
+      if (!signal.has_company()) continue;
+      auto priority = priority_of(signal.provider_id());
+      RankedSignal ranked{&signal.company(), priority ? *priority : UnknownPriority, signal.update_date()};
+      for (auto& field : fields) {
+        field.Add(ranked);
+      }
+    }
+
+    Company company;
+    for (const auto& field : fields) {
+      field.Finish(company);
+    }
     return company;
   }
 }
@@ -0,0 +1,215 @@
+#include "yellow_pages.h"
+#include "allocation_counter.h"
+#include "batch_merge.h"
+#include "company_store.h"
+#include "merge_state.h"
+#include "synthetic_signals.h"
+
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace YellowPages;
+using namespace std;
+
+// Поставщики со случайными идентификаторами, из которых плотная таблица не собирается
+Providers GenerateSparseProviders(size_t count, mt19937& gen) {
+  Providers providers;
+  uniform_int_distribution<uint64_t> id;
+  uniform_int_distribution<uint32_t> priority(0, 9);
+  while (providers.size() < count) {
+    providers[id(gen)].set_priority(priority(gen));
+  }
+  return providers;
+}
+
+// Время одного поиска приоритета: unordered_map::at против ProviderPriorities::Find
+void MeasurePriorityLookup(const string& title, const Providers& providers, mt19937& gen) {
+  vector<uint64_t> ids;
+  for (const auto& [id, provider] : providers) {
+    ids.push_back(id);
+  }
+  vector<uint64_t> lookups(1 << 22);
+  uniform_int_distribution<size_t> index(0, ids.size() - 1);
+  for (auto& id : lookups) {
+    id = ids[index(gen)];
+  }
+
+  uint64_t mapSum = 0;
+  Stopwatch mapStopwatch;
+  for (uint64_t id : lookups) {
+    mapSum += providers.at(id).priority();
+  }
+  double mapSeconds = mapStopwatch.Seconds();
+
+  ProviderPriorities priorities(providers);
+  uint64_t tableSum = 0;
+  Stopwatch tableStopwatch;
+  for (uint64_t id : lookups) {
+    tableSum += *priorities.Find(id);
+  }
+  double tableSeconds = tableStopwatch.Seconds();
+
+  cout << fixed << setprecision(1) << title << ": unordered_map::at " << mapSeconds * 1e9 / lookups.size()
+       << " ns, ProviderPriorities " << tableSeconds * 1e9 / lookups.size() << " ns per lookup"
+       << (mapSum == tableSum ? "" : " (MISMATCH)") << endl;
+}
+
+struct MergeResult {
+  double seconds;
+  size_t bytes;
+  uint64_t allocations;
+};
+
+template <class MergeFunc>
+MergeResult MeasureMerge(const vector<Signals>& clusters, const Providers& providers, MergeFunc merge) {
+  size_t totalBytes = 0;
+  AllocationCounter allocations;
+  Stopwatch stopwatch;
+  for (const auto& signals : clusters) {
+    totalBytes += merge(signals, providers).ByteSizeLong();
+  }
+  return {stopwatch.Seconds(), totalBytes, allocations.Count()};
+}
+
+int main(int argc, char* argv[]) {
+  size_t companyCount = argc > 1 ? stoul(argv[1]) : 100'000;
+  size_t maxSignals = argc > 2 ? stoul(argv[2]) : 16;
+  SignalGeneratorOptions generator{.max_signals = maxSignals};
+
+  mt19937 gen(42);
+  auto providers = GenerateProviders(generator.provider_count, gen);
+  auto clusters = GenerateClusters(companyCount, gen, generator);
+  size_t signalCount = 0;
+  for (const auto& signals : clusters) {
+    signalCount += signals.size();
+  }
+  cout << companyCount << " companies, " << signalCount << " signals" << endl;
+
+  auto reflection = MeasureMerge(clusters, providers, [](const Signals& signals, const Providers& providers) {
+    return MergeWithReflection(signals, providers);
+  });
+  auto typed = MeasureMerge(clusters, providers, [](const Signals& signals, const Providers& providers) {
+    return Merge(signals, providers);
+  });
+
+  cout << fixed << setprecision(0)
+       << "reflection: " << reflection.seconds * 1e9 / companyCount << " ns/company, "
+       << setprecision(1) << double(reflection.allocations) / companyCount << " allocations/company" << endl
+       << setprecision(0)
+       << "typed:      " << typed.seconds * 1e9 / companyCount << " ns/company, "
+       << setprecision(1) << double(typed.allocations) / companyCount << " allocations/company"
+       << (reflection.bytes == typed.bytes ? "" : " (MISMATCH)") << endl;
+
+  // Приоритет ищется один раз на сигнал и поле — здесь поставщиков 10 тысяч
+  mt19937 providerGen(7);
+  MeasurePriorityLookup("10K dense providers", GenerateProviders(10'000, providerGen), providerGen);
+  MeasurePriorityLookup("10K sparse providers", GenerateSparseProviders(10'000, providerGen), providerGen);
+  ProviderPriorities priorities(providers);
+  auto table = MeasureMerge(clusters, providers, [&priorities](const Signals& signals, const Providers&) {
+    return Merge(signals, priorities);
+  });
+  cout << setprecision(0)
+       << "typed with ProviderPriorities: " << table.seconds * 1e9 / companyCount << " ns/company"
+       << (table.bytes == typed.bytes ? "" : " (MISMATCH)") << endl;
+
+  // Инкрементальное слияние: каждая организация получает один изменённый сигнал
+  // случайного поставщика, полное слияние нужно, только если ApplySignal отказался
+  {
+    vector<MergeState> states;
+    states.reserve(clusters.size());
+    for (const auto& signals : clusters) {
+      states.push_back(BuildMergeState(signals, priorities));
+    }
+    vector<Signal> changes;
+    changes.reserve(clusters.size());
+    for (size_t i = 0; i < clusters.size(); ++i) {
+      changes.push_back(GenerateCluster(1, gen, generator).front());
+    }
+    size_t remerged = 0;
+    Stopwatch stopwatch;
+    for (size_t i = 0; i < clusters.size(); ++i) {
+      if (!ApplySignal(states[i], changes[i], priorities)) {
+        ++remerged;
+        auto signals = clusters[i];
+        erase_if(signals, [&](const Signal& signal) { return signal.provider_id() == changes[i].provider_id(); });
+        signals.push_back(changes[i]);
+        states[i] = BuildMergeState(signals, priorities);
+      }
+    }
+    cout << setprecision(0)
+         << "incremental, 1 changed signal: " << stopwatch.Seconds() * 1e9 / companyCount << " ns/company, "
+         << setprecision(1) << 100.0 * remerged / companyCount << "% companies merged again" << endl;
+  }
+
+  // Хранилище слитых организаций: запись и точечные запросы по существующим и
+  // отсутствующим ключам (чётные ключи есть, нечётных нет)
+  {
+    auto directory = (filesystem::temp_directory_path() / "yellow_pages_benchmark_store").string();
+    Stopwatch writeStopwatch;
+    {
+      CompanyStoreWriter writer(directory);
+      for (size_t i = 0; i < clusters.size(); ++i) {
+        writer.Add(2 * i, Merge(clusters[i], priorities));
+      }
+      writer.Finish();
+    }
+    double writeSeconds = writeStopwatch.Seconds();
+
+    auto store = CompanyStore::Open(directory);
+    uniform_int_distribution<uint64_t> company(0, clusters.size() - 1);
+    vector<uint64_t> lookups(1 << 20);
+    for (auto& id : lookups) {
+      id = 2 * company(gen);
+    }
+    size_t foundBytes = 0;
+    Stopwatch hitStopwatch;
+    for (uint64_t id : lookups) {
+      foundBytes += store.FindSerialized(id)->size();
+    }
+    double hitSeconds = hitStopwatch.Seconds();
+    size_t wronglyFound = 0;
+    Stopwatch missStopwatch;
+    for (uint64_t id : lookups) {
+      wronglyFound += store.FindSerialized(id + 1).has_value();
+    }
+    double missSeconds = missStopwatch.Seconds();
+    filesystem::remove_all(directory);
+
+    cout << setprecision(0)
+         << "store: merge and write " << writeSeconds * 1e9 / companyCount << " ns/company, lookup "
+         << hitSeconds * 1e9 / lookups.size() << " ns hit, " << missSeconds * 1e9 / lookups.size() << " ns miss"
+         << (foundBytes > 0 && wronglyFound == 0 ? "" : " (MISMATCH)") << endl;
+  }
+
+  vector<size_t> threadCounts = {1};
+  if (thread::hardware_concurrency() > 1) {
+    threadCounts.push_back(thread::hardware_concurrency());
+  }
+  for (size_t threadCount : threadCounts) {
+    size_t batchBytes = 0;
+    AllocationCounter allocations;
+    Stopwatch stopwatch;
+    BatchMerger merger(providers, [&batchBytes](uint64_t, const Company& company) {
+      batchBytes += company.ByteSizeLong();
+    }, {.thread_count = threadCount});
+    for (size_t id = 0; id < clusters.size(); ++id) {
+      for (const auto& signal : clusters[id]) {
+        merger.Add(id, signal);
+      }
+    }
+    merger.Finish();
+    double batchSeconds = stopwatch.Seconds();
+    auto stats = merger.GetStats();
+    cout << setprecision(0)
+         << "batch, " << threadCount << " threads: " << batchSeconds * 1e9 / companyCount << " ns/company"
+         << " including signal copies, " << setprecision(1) << double(allocations.Count()) / companyCount
+         << " heap allocations/company, arenas " << stats.arena_bytes / double(1 << 20) << " MB in total"
+         << (batchBytes == typed.bytes ? "" : " (MISMATCH)") << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include "merge_state.h"
+#include "company_fields.h"
+#include "message_hash.h"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+
+using namespace std;
+
+namespace YellowPages {
+  namespace {
+    bool HasAnyField(const Company& company) {
+      return WorkingTimeField::Has(company) || AddressField::Has(company)
+        || !NamesField::Get(company).empty() || !PhonesField::Get(company).empty()
+        || !UrlsField::Get(company).empty();
+    }
+
+    bool Contains(const google::protobuf::RepeatedField<uint64_t>& ids, uint64_t id) {
+      return find(ids.begin(), ids.end(), id) != ids.end();
+    }
+
+    // Как ValueMerger в Merge: приоритет, затем дата обновления, при равенстве
+    // побеждает более поздний сигнал
+    template <class Field>
+    void ApplyValue(MergeState::Value& state, const Signal& signal, uint32_t priority, Company& company) {
+      if (!Field::Has(signal.company())) return;
+      if (state.present()
+          && pair(state.priority(), state.update_date()) > pair(priority, signal.update_date())) return;
+      state.set_present(true);
+      state.set_priority(priority);
+      state.set_provider_id(signal.provider_id());
+      state.set_update_date(signal.update_date());
+
+      const auto& value = Field::Get(signal.company());
+      if (value.ByteSizeLong() == 0) {
+        Field::Clear(company);
+      } else {
+        Field::Mutable(company)->CopyFrom(value);
+      }
+    }
+
+    // Как RepValueMerger: повтор ищется по сохранённым хешам и проверяется сравнением.
+    // Хеши собираются в таблицу один раз на сигнал, так что поиск повторов линеен.
+    template <class Field>
+    void ApplyRepValue(MergeState::RepValue& state, const Signal& signal, uint32_t priority, Company& company) {
+      const auto& values = Field::Get(signal.company());
+      if (values.empty()) return;
+      auto& result = *Field::Mutable(company);
+      if (state.provider_ids_size() > 0 && state.priority() > priority) return;
+      if (state.provider_ids_size() == 0 || state.priority() < priority) {
+        state.clear_provider_ids();
+        state.clear_hashes();
+        result.Clear();
+      }
+      state.set_priority(priority);
+      if (!Contains(state.provider_ids(), signal.provider_id())) {
+        state.add_provider_ids(signal.provider_id());
+      }
+
+      unordered_multimap<uint64_t, int> indices;
+      indices.reserve(state.hashes_size() + values.size());
+      for (int i = 0; i < state.hashes_size(); ++i) {
+        indices.emplace(state.hashes(i), i);
+      }
+      for (const auto& value : values) {
+        auto hash = Hash(value);
+        auto [first, last] = indices.equal_range(hash);
+        bool seen = any_of(first, last, [&](const auto& item) {
+          return Equal(result.Get(item.second), value);
+        });
+        if (!seen) {
+          indices.emplace(hash, state.hashes_size());
+          state.add_hashes(hash);
+          result.Add()->CopyFrom(value);
+        }
+      }
+    }
+
+    void Apply(MergeState& state, const Signal& signal, const ProviderPriorities& priorities) {
+      if (!signal.has_company() || !HasAnyField(signal.company())) return;
+      auto priority = priorities.Find(signal.provider_id());
+      if (!priority) {
+        throw out_of_range("Unknown provider");
+      }
+
+      auto& company = *state.mutable_company();
+      ApplyValue<WorkingTimeField>(*state.mutable_working_time(), signal, *priority, company);
+      ApplyValue<AddressField>(*state.mutable_address(), signal, *priority, company);
+      ApplyRepValue<NamesField>(*state.mutable_names(), signal, *priority, company);
+      ApplyRepValue<PhonesField>(*state.mutable_phones(), signal, *priority, company);
+      ApplyRepValue<UrlsField>(*state.mutable_urls(), signal, *priority, company);
+    }
+
+    // Прежнее значение одиночного поля от этого поставщика заменяется, только
+    // если в новом сигнале поле есть и ранг нового сигнала не ниже: иначе
+    // победителем может оказаться сигнал другого поставщика
+    template <class Field>
+    bool CanReplace(const MergeState::Value& state, const Signal& signal, optional<uint32_t> priority) {
+      if (!state.present() || state.provider_id() != signal.provider_id()) {
+        return true;
+      }
+      return signal.has_company() && Field::Has(signal.company()) && priority
+        && pair(*priority, signal.update_date()) >= pair(state.priority(), state.update_date());
+    }
+
+    // Какие значения повторяющегося поля дал именно этот поставщик, не хранится.
+    // Хешей должно быть столько же, сколько значений: иначе состояние испорчено
+    // или устарело, и ApplyRepValue вышел бы за границы поля.
+    template <class Field>
+    bool CanReplace(const MergeState::RepValue& state, const Company& company, const Signal& signal) {
+      return state.hashes_size() == Field::Get(company).size()
+        && !Contains(state.provider_ids(), signal.provider_id());
+    }
+  }
+
+  MergeState BuildMergeState(span<const Signal> signals, const ProviderPriorities& priorities) {
+    MergeState state;
+    for (const auto& signal : signals) {
+      Apply(state, signal, priorities);
+    }
+    return state;
+  }
+
+  bool ApplySignal(MergeState& state, const Signal& signal, const ProviderPriorities& priorities) {
+    auto priority = priorities.Find(signal.provider_id());
+    if (!CanReplace<WorkingTimeField>(state.working_time(), signal, priority)
+        || !CanReplace<AddressField>(state.address(), signal, priority)
+        || !CanReplace<NamesField>(state.names(), state.company(), signal)
+        || !CanReplace<PhonesField>(state.phones(), state.company(), signal)
+        || !CanReplace<UrlsField>(state.urls(), state.company(), signal)) {
+      return false;
+    }
+    Apply(state, signal, priorities);
+    return true;
+  }
+}
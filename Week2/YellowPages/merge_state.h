@@ -0,0 +1,28 @@
+#pragma once
+
+#include "merge_state.pb.h"
+#include "provider_priorities.h"
+#include "signal.pb.h"
+
+#include <span>
+
+namespace YellowPages {
+  // Инкрементальное слияние. MergeState хранит результат слияния вместе с
+  // приоритетами и поставщиками победителей каждого поля и хешами значений
+  // повторяющихся полей, так что новый сигнал учитывается без прохода по остальным.
+  //
+  // state.company() совпадает с Merge по тем же сигналам, если каждый изменённый
+  // сигнал считать перенесённым в конец списка. Поля, добавленные в Company
+  // после merge_state.proto, в состоянии не учитываются.
+
+  // Состояние слияния сигналов с нуля
+  MergeState BuildMergeState(std::span<const Signal> signals, const ProviderPriorities& priorities);
+
+  // Учитывает новый или изменённый сигнал поставщика; прежний сигнал этого
+  // поставщика об организации, если он был, считается заменённым. Если прежний
+  // сигнал дал значения, которые новый может отменить, состояние не меняется и
+  // возвращается false: организацию нужно слить заново по всем сигналам. Так же
+  // и для испорченного или устаревшего состояния.
+  // Неизвестный поставщик с данными — out_of_range, как и в Merge.
+  bool ApplySignal(MergeState& state, const Signal& signal, const ProviderPriorities& priorities);
+}
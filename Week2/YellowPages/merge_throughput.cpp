@@ -0,0 +1,79 @@
+#include "yellow_pages.h"
+#include "allocation_counter.h"
+#include "synthetic_signals.h"
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace YellowPages;
+using namespace std;
+
+// Пропускная способность Merge на синтетических организациях. Каждый прогон
+// меняет один параметр генератора относительно базового и печатает организации
+// и сигналы в секунду, выделения из кучи на организацию и пиковый прирост живой
+// памяти кучи за время слияния — без сгенерированных сигналов.
+//
+// Запуск: yellow_pages_throughput [организаций] [максимум сигналов на организацию]
+
+void Run(const string& label, size_t companyCount, SignalGeneratorOptions generator) {
+  mt19937 gen(42);
+  auto providers = GenerateProviders(generator.provider_count, gen);
+  ProviderPriorities priorities(providers);
+  auto clusters = GenerateClusters(companyCount, gen, generator);
+  size_t signalCount = 0;
+  for (const auto& signals : clusters) {
+    signalCount += signals.size();
+  }
+
+  // Разовая инициализация protobuf не должна попасть в пик первого прогона
+  Merge(clusters.front(), priorities);
+
+  size_t mergedBytes = 0;
+  AllocationCounter allocations;
+  Stopwatch stopwatch;
+  for (const auto& signals : clusters) {
+    mergedBytes += Merge(signals, priorities).ByteSizeLong();
+  }
+  double seconds = stopwatch.Seconds();
+
+  cout << setw(24) << left << label << right << fixed << setprecision(0)
+       << setw(10) << companyCount / seconds << " companies/s"
+       << setw(11) << signalCount / seconds << " signals/s"
+       << setprecision(1) << setw(7) << double(allocations.Count()) / companyCount << " allocations/company"
+       << setw(8) << double(mergedBytes) / companyCount << " bytes/company"
+       << setprecision(1) << ", peak heap " << allocations.PeakBytes() / 1024.0 << " KB" << endl;
+}
+
+int main(int argc, char* argv[]) {
+  size_t companyCount = argc > 1 ? stoul(argv[1]) : 100'000;
+  SignalGeneratorOptions base;
+  if (argc > 2) {
+    base.max_signals = stoul(argv[2]);
+  }
+
+  Run("base", companyCount, base);
+  for (size_t providerCount : {10, 10'000}) {
+    auto options = base;
+    options.provider_count = providerCount;
+    Run(to_string(providerCount) + " providers", companyCount, options);
+  }
+  for (double duplicateShare : {0.0, 0.95}) {
+    auto options = base;
+    options.duplicate_share = duplicateShare;
+    Run(to_string(static_cast<int>(duplicateShare * 100)) + "% duplicates", companyCount, options);
+  }
+  {
+    auto options = base;
+    options.address_words = 64;
+    Run("64-word addresses", companyCount, options);
+  }
+  {
+    auto options = base;
+    options.max_signals = base.max_signals * 16;
+    Run("up to " + to_string(options.max_signals) + " signals", companyCount / 16, options);
+  }
+  return 0;
+}
@@ -0,0 +1,174 @@
+#include "message_hash.h"
+
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+#include <google/protobuf/util/message_differencer.h>
+
+using namespace std;
+using google::protobuf::FieldDescriptor;
+using google::protobuf::Message;
+
+namespace YellowPages {
+  namespace {
+    // FNV-1a по байтам с перемешиванием splitmix64 в конце
+    class Hasher {
+    public:
+      Hasher& Add(uint64_t value) {
+        for (int i = 0; i < 8; ++i) {
+          AddByte(static_cast<unsigned char>(value >> (8 * i)));
+        }
+        return *this;
+      }
+
+      // Длина входит в хеш, чтобы границы соседних строк не сдвигались
+      Hasher& Add(string_view value) {
+        Add(static_cast<uint64_t>(value.size()));
+        for (char c : value) {
+          AddByte(static_cast<unsigned char>(c));
+        }
+        return *this;
+      }
+
+      uint64_t Get() const {
+        uint64_t x = state_;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+      }
+
+    private:
+      void AddByte(unsigned char byte) {
+        state_ = (state_ ^ byte) * 0x100000001B3ULL;
+      }
+
+      uint64_t state_ = 0xCBF29CE484222325ULL;
+    };
+
+    void AddMessage(Hasher& hasher, const Message& message);
+
+    void AddValue(Hasher& hasher, const Message& message, const FieldDescriptor* field, int index) {
+      auto reflection = message.GetReflection();
+      bool repeated = field->is_repeated();
+      switch (field->cpp_type()) {
+        case FieldDescriptor::CPPTYPE_INT32:
+          hasher.Add(static_cast<uint64_t>(repeated ? reflection->GetRepeatedInt32(message, field, index)
+                                                    : reflection->GetInt32(message, field)));
+          break;
+        case FieldDescriptor::CPPTYPE_INT64:
+          hasher.Add(static_cast<uint64_t>(repeated ? reflection->GetRepeatedInt64(message, field, index)
+                                                    : reflection->GetInt64(message, field)));
+          break;
+        case FieldDescriptor::CPPTYPE_UINT32:
+          hasher.Add(repeated ? reflection->GetRepeatedUInt32(message, field, index)
+                              : reflection->GetUInt32(message, field));
+          break;
+        case FieldDescriptor::CPPTYPE_UINT64:
+          hasher.Add(repeated ? reflection->GetRepeatedUInt64(message, field, index)
+                              : reflection->GetUInt64(message, field));
+          break;
+        case FieldDescriptor::CPPTYPE_DOUBLE: {
+          double value = repeated ? reflection->GetRepeatedDouble(message, field, index)
+                                  : reflection->GetDouble(message, field);
+          uint64_t bits;
+          memcpy(&bits, &value, sizeof(bits));
+          hasher.Add(bits);
+          break;
+        }
+        case FieldDescriptor::CPPTYPE_FLOAT: {
+          float value = repeated ? reflection->GetRepeatedFloat(message, field, index)
+                                 : reflection->GetFloat(message, field);
+          uint32_t bits;
+          memcpy(&bits, &value, sizeof(bits));
+          hasher.Add(bits);
+          break;
+        }
+        case FieldDescriptor::CPPTYPE_BOOL:
+          hasher.Add(repeated ? reflection->GetRepeatedBool(message, field, index)
+                              : reflection->GetBool(message, field));
+          break;
+        case FieldDescriptor::CPPTYPE_ENUM:
+          hasher.Add(static_cast<uint64_t>(repeated ? reflection->GetRepeatedEnumValue(message, field, index)
+                                                    : reflection->GetEnumValue(message, field)));
+          break;
+        case FieldDescriptor::CPPTYPE_STRING: {
+          string scratch;
+          hasher.Add(repeated ? reflection->GetRepeatedStringReference(message, field, index, &scratch)
+                              : reflection->GetStringReference(message, field, &scratch));
+          break;
+        }
+        case FieldDescriptor::CPPTYPE_MESSAGE:
+          AddMessage(hasher, repeated ? reflection->GetRepeatedMessage(message, field, index)
+                                      : reflection->GetMessage(message, field));
+          break;
+      }
+    }
+
+    void AddMessage(Hasher& hasher, const Message& message) {
+      vector<const FieldDescriptor*> fields;
+      message.GetReflection()->ListFields(message, &fields);
+      hasher.Add(static_cast<uint64_t>(fields.size()));
+      for (auto field : fields) {
+        hasher.Add(static_cast<uint64_t>(field->number()));
+        if (field->is_repeated()) {
+          int size = message.GetReflection()->FieldSize(message, field);
+          hasher.Add(static_cast<uint64_t>(size));
+          for (int i = 0; i < size; ++i) {
+            AddValue(hasher, message, field, i);
+          }
+        } else {
+          AddValue(hasher, message, field, 0);
+        }
+      }
+    }
+  }
+
+  uint64_t Hash(const Name& name) {
+    return Hasher().Add(name.value()).Add(static_cast<uint64_t>(name.type())).Get();
+  }
+
+  uint64_t Hash(const Phone& phone) {
+    return Hasher()
+      .Add(phone.formatted())
+      .Add(static_cast<uint64_t>(phone.type()))
+      .Add(phone.country_code())
+      .Add(phone.local_code())
+      .Add(phone.number())
+      .Add(phone.extension())
+      .Add(phone.description())
+      .Get();
+  }
+
+  uint64_t Hash(const Url& url) {
+    return Hasher().Add(url.value()).Get();
+  }
+
+  uint64_t Hash(const Message& message) {
+    Hasher hasher;
+    AddMessage(hasher, message);
+    return hasher.Get();
+  }
+
+  bool Equal(const Name& lhs, const Name& rhs) {
+    return lhs.type() == rhs.type() && lhs.value() == rhs.value();
+  }
+
+  bool Equal(const Phone& lhs, const Phone& rhs) {
+    return lhs.type() == rhs.type()
+      && lhs.number() == rhs.number()
+      && lhs.formatted() == rhs.formatted()
+      && lhs.country_code() == rhs.country_code()
+      && lhs.local_code() == rhs.local_code()
+      && lhs.extension() == rhs.extension()
+      && lhs.description() == rhs.description();
+  }
+
+  bool Equal(const Url& lhs, const Url& rhs) {
+    return lhs.value() == rhs.value();
+  }
+
+  bool Equal(const Message& lhs, const Message& rhs) {
+    return google::protobuf::util::MessageDifferencer::Equals(lhs, rhs);
+  }
+}
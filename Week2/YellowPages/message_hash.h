@@ -0,0 +1,39 @@
+#pragma once
+
+#include "company.pb.h"
+
+#include <cstddef>
+#include <cstdint>
+
+#include <google/protobuf/message.h>
+
+namespace YellowPages {
+  // Структурные хеш и равенство сообщений по содержимому полей, без сериализации.
+  // Хеш не зависит от платформы и версии protobuf, поэтому его можно сохранять.
+  // Для известных типов значения разбираются через сгенерированные методы, для
+  // остальных — через Reflection.
+  uint64_t Hash(const Name& name);
+  uint64_t Hash(const Phone& phone);
+  uint64_t Hash(const Url& url);
+  uint64_t Hash(const google::protobuf::Message& message);
+
+  bool Equal(const Name& lhs, const Name& rhs);
+  bool Equal(const Phone& lhs, const Phone& rhs);
+  bool Equal(const Url& lhs, const Url& rhs);
+  bool Equal(const google::protobuf::Message& lhs, const google::protobuf::Message& rhs);
+
+  // Для множеств указателей на сообщения, сравниваемых по содержимому
+  struct MessagePtrHash {
+    template <class Message>
+    size_t operator()(const Message* message) const {
+      return static_cast<size_t>(Hash(*message));
+    }
+  };
+
+  struct MessagePtrEqual {
+    template <class Message>
+    bool operator()(const Message* lhs, const Message* rhs) const {
+      return Equal(*lhs, *rhs);
+    }
+  };
+}
@@ -0,0 +1,45 @@
+#include "provider_priorities.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace YellowPages {
+  namespace {
+    // Плотная таблица не больше стольких элементов на поставщика
+    constexpr uint64_t MaxDenseRatio = 4;
+    constexpr uint64_t MinDenseSize = 1 << 16;
+  }
+
+  ProviderPriorities::ProviderPriorities(const Providers& providers)
+    : size_(providers.size())
+  {
+    uint64_t maxId = 0;
+    for (const auto& [id, provider] : providers) {
+      maxId = max(maxId, id);
+    }
+
+    if (!providers.empty() && maxId < min(MaxDenseSize, max(MinDenseSize, MaxDenseRatio * providers.size()))) {
+      dense_.assign(maxId + 1, Unknown);
+      for (const auto& [id, provider] : providers) {
+        dense_[id] = provider.priority();
+      }
+      return;
+    }
+
+    size_t capacity = 2;
+    shift_ = 63;
+    while (capacity < 2 * providers.size()) {
+      capacity *= 2;
+      --shift_;
+    }
+    slots_.resize(capacity);
+    for (const auto& [id, provider] : providers) {
+      size_t i = SlotOf(id);
+      while (slots_[i].used) {
+        i = (i + 1) & (capacity - 1);
+      }
+      slots_[i] = {id, provider.priority(), true};
+    }
+  }
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "provider.pb.h"
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+namespace YellowPages {
+  using Providers = std::unordered_map<uint64_t, Provider>;
+
+  // Приоритеты поставщиков, собранные один раз перед слиянием многих организаций.
+  // Если идентификаторы поставщиков плотные, приоритет берётся из массива по
+  // индексу, иначе — из хеш-таблицы с открытой адресацией, заполненной не больше
+  // чем наполовину: обычно это одно обращение к памяти вместо двух-трёх в
+  // unordered_map.
+  class ProviderPriorities {
+  public:
+    ProviderPriorities() = default;
+    explicit ProviderPriorities(const Providers& providers);
+
+    std::optional<uint32_t> Find(uint64_t provider_id) const {
+      if (slots_.empty()) {
+        // Плотная таблица не длиннее MaxDenseSize; явная проверка показывает это
+        // и компилятору, иначе GCC видит выход за границы в недостижимой ветке
+        if (provider_id >= MaxDenseSize || provider_id >= dense_.size()) {
+          return std::nullopt;
+        }
+        uint64_t priority = dense_[static_cast<uint32_t>(provider_id)];
+        if (priority == Unknown) {
+          return std::nullopt;
+        }
+        return static_cast<uint32_t>(priority);
+      }
+      for (size_t i = SlotOf(provider_id);; i = (i + 1) & (slots_.size() - 1)) {
+        const Slot& slot = slots_[i];
+        if (!slot.used) {
+          return std::nullopt;
+        }
+        if (slot.provider_id == provider_id) {
+          return slot.priority;
+        }
+      }
+    }
+
+    size_t size() const {
+      return size_;
+    }
+
+  private:
+    static constexpr uint64_t Unknown = UINT64_MAX;
+    static constexpr uint64_t MaxDenseSize = UINT32_MAX;
+
+    struct Slot {
+      uint64_t provider_id = 0;
+      uint32_t priority = 0;
+      bool used = false;
+    };
+
+    // Фибоначчиево хеширование: старшие биты произведения на 2^64 / φ
+    size_t SlotOf(uint64_t provider_id) const {
+      return (provider_id * 0x9E3779B97F4A7C15ULL) >> shift_;
+    }
+
+    std::vector<uint64_t> dense_;
+    // Размер — степень двойки, не меньше удвоенного числа поставщиков
+    std::vector<Slot> slots_;
+    int shift_ = 64;
+    size_t size_ = 0;
+  };
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "yellow_pages.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+// Генераторы синтетических сигналов для бенчмарков
+
+class Stopwatch {
+  std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+
+public:
+  double Seconds() const {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_;
+    return elapsed.count();
+  }
+};
+
+struct SignalGeneratorOptions {
+  size_t provider_count = 100;
+  // Сигналов об организации — от 1 до стольких
+  size_t max_signals = 16;
+  // Доля названий, телефонов и сайтов, повторяющих уже названные другими
+  // поставщиками той же организации
+  double duplicate_share = 0.7;
+  // Слов в адресе
+  size_t address_words = 4;
+};
+
+// Поставщики 0..count-1 с приоритетами от 0 до 9
+inline YellowPages::Providers GenerateProviders(size_t count, std::mt19937& gen) {
+  YellowPages::Providers providers;
+  std::uniform_int_distribution<uint32_t> priority(0, 9);
+  for (size_t i = 0; i < count; ++i) {
+    auto& provider = providers[i];
+    provider.set_name("Provider " + std::to_string(i));
+    provider.set_priority(priority(gen));
+  }
+  return providers;
+}
+
+// Сигналы об одной организации: поставщики повторяют друг за другом часть
+// названий, телефонов и сайтов, адрес и время работы есть не у всех
+inline YellowPages::Signals GenerateCluster(size_t signalCount, std::mt19937& gen, SignalGeneratorOptions options = {}) {
+  using namespace YellowPages;
+  std::uniform_int_distribution<uint64_t> provider(0, options.provider_count - 1);
+  std::uniform_int_distribution<uint64_t> updateDate(1'500'000'000, 1'700'000'000);
+  std::uniform_int_distribution<int> count(0, 3);
+  std::uniform_int_distribution<int> number(1'000'000, 9'999'999);
+  std::bernoulli_distribution present(0.5);
+  std::bernoulli_distribution duplicate(options.duplicate_share);
+
+  // Уже названные значения организации; повтор выбирается из них
+  std::vector<Name> names;
+  std::vector<Phone> phones;
+  std::vector<std::string> urls;
+  auto pick = [&](auto& pool, auto make) {
+    if (pool.empty() || !duplicate(gen)) {
+      pool.push_back(make());
+      return pool.back();
+    }
+    return pool[std::uniform_int_distribution<size_t>(0, pool.size() - 1)(gen)];
+  };
+
+  Signals signals(signalCount);
+  for (auto& signal : signals) {
+    signal.set_provider_id(provider(gen));
+    signal.set_update_date(updateDate(gen));
+    auto& company = *signal.mutable_company();
+    if (present(gen)) {
+      auto& address = *company.mutable_address();
+      std::string formatted = "Russia, Moscow";
+      for (size_t i = 0; i < options.address_words; ++i) {
+        formatted += ", street " + std::to_string(count(gen));
+      }
+      address.set_formatted(formatted);
+      address.mutable_coords()->set_lat(55.76 + count(gen) * 1e-4);
+      address.mutable_coords()->set_lon(37.6);
+    }
+    for (int i = count(gen); i > 0; --i) {
+      *company.add_names() = pick(names, [&] {
+        Name name;
+        name.set_value("Company name " + std::to_string(number(gen)));
+        name.set_type(static_cast<Name::Type>(names.size() % 3));
+        return name;
+      });
+    }
+    for (int i = count(gen); i > 0; --i) {
+      *company.add_phones() = pick(phones, [&] {
+        auto digits = std::to_string(number(gen));
+        Phone phone;
+        phone.set_formatted("+7 (495) " + digits);
+        phone.set_country_code("7");
+        phone.set_local_code("495");
+        phone.set_number(digits);
+        return phone;
+      });
+    }
+    for (int i = count(gen); i > 0; --i) {
+      company.add_urls()->set_value(pick(urls, [&] {
+        return "https://example" + std::to_string(number(gen)) + ".ru/";
+      }));
+    }
+    if (present(gen)) {
+      auto& workingTime = *company.mutable_working_time();
+      workingTime.set_formatted("Daily 9-21");
+      auto& interval = *workingTime.add_intervals();
+      interval.set_minutes_from(9 * 60);
+      interval.set_minutes_to(21 * 60);
+    }
+  }
+  return signals;
+}
+
+// Организации с числом сигналов от 1 до options.max_signals
+inline std::vector<YellowPages::Signals> GenerateClusters(size_t companyCount, std::mt19937& gen,
+                                                          SignalGeneratorOptions options = {}) {
+  std::uniform_int_distribution<size_t> signalCount(1, options.max_signals);
+  std::vector<YellowPages::Signals> clusters(companyCount);
+  for (auto& signals : clusters) {
+    signals = GenerateCluster(signalCount(gen), gen, options);
+  }
+  return clusters;
+}
@@ -1,9 +1,16 @@
 #include "yellow_pages.h"
+#include "batch_merge.h"
+#include "company_store.h"
+#include "merge_state.h"
+#include "message_hash.h"
 
 #include "test_runner.h"
 
 #include <algorithm>
+#include <filesystem>
+#include <stdexcept>
 #include <utility>
+#include <vector>
 
 using namespace YellowPages;
 using namespace std;
@@ -159,7 +166,383 @@ void TestMerge() {
   ASSERT(company.working_time() == signals[1].company().working_time());
 }
 
+void TestMergeMatchesReflection() {
+  auto signals = GenerateSignals();
+  Providers providers;
+  providers[31415].set_priority(10);
+  providers[271828].set_priority(10);
+  providers[100500].set_priority(3);
+  ASSERT(Merge(signals, providers) == MergeWithReflection(signals, providers));
+
+  // Третий поставщик становится самым приоритетным
+  providers[100500].set_priority(20);
+  ASSERT(Merge(signals, providers) == MergeWithReflection(signals, providers));
+
+  signals.emplace_back().set_provider_id(31415);
+  ASSERT(Merge(signals, providers) == MergeWithReflection(signals, providers));
+  ASSERT(Merge({}, providers) == Company());
+}
+
+void TestMergeByUpdateDate() {
+  Providers providers;
+  providers[1].set_priority(5);
+  providers[2].set_priority(5);
+  providers[3].set_priority(1);
+
+  Signals signals(4);
+  signals[0].set_provider_id(1);
+  signals[0].set_update_date(200);
+  signals[0].mutable_company()->mutable_address()->set_formatted("Новый адрес");
+  signals[0].mutable_company()->add_urls()->set_value("http://first/");
+  signals[1].set_provider_id(2);
+  signals[1].set_update_date(100);
+  signals[1].mutable_company()->mutable_address()->set_formatted("Старый адрес");
+  signals[1].mutable_company()->add_urls()->set_value("http://second/");
+  signals[1].mutable_company()->add_urls()->set_value("http://first/");
+  // Свежая дата не помогает менее приоритетному поставщику
+  signals[2].set_provider_id(3);
+  signals[2].set_update_date(300);
+  signals[2].mutable_company()->mutable_address()->set_formatted("Самый новый адрес");
+  // При равных приоритете и дате побеждает последний сигнал
+  signals[3].set_provider_id(2);
+  signals[3].set_update_date(100);
+  signals[3].mutable_company()->mutable_working_time()->set_formatted("Днём");
+  signals[0].mutable_company()->mutable_working_time()->set_formatted("Ночью");
+  signals[0].set_update_date(100);
+
+  auto company = Merge(signals, providers);
+  ASSERT_EQUAL(company.address().formatted(), "Старый адрес");
+  ASSERT_EQUAL(company.working_time().formatted(), "Днём");
+  signals[0].set_update_date(101);
+  company = Merge(signals, providers);
+  ASSERT_EQUAL(company.address().formatted(), "Новый адрес");
+  ASSERT_EQUAL(company.working_time().formatted(), "Ночью");
+  ASSERT(company == MergeWithReflection(signals, providers));
+  ASSERT(company == BuildMergeState(signals, ProviderPriorities(providers)).company());
+
+  ASSERT_EQUAL(company.urls_size(), 2);
+  ASSERT_EQUAL(company.urls(0).value(), "http://first/");
+  ASSERT_EQUAL(company.urls(1).value(), "http://second/");
+
+  // Тот же вход — те же байты и тот же хеш содержимого
+  auto again = Merge(signals, providers);
+  ASSERT_EQUAL(again.SerializeAsString(), company.SerializeAsString());
+  ASSERT_EQUAL(Hash(again), Hash(company));
+}
+
+void TestMessageHash() {
+  auto signals = GenerateSignals();
+  const auto& phones = signals[0].company().phones();
+  const auto& samePhone = signals[1].company().phones(1);
+
+  ASSERT(Equal(phones[1], samePhone));
+  ASSERT_EQUAL(Hash(phones[1]), Hash(samePhone));
+  ASSERT(!Equal(phones[0], phones[1]));
+  ASSERT(Hash(phones[0]) != Hash(phones[1]));
+
+  Phone described = samePhone;
+  described.set_description("Факс");
+  ASSERT(!Equal(described, samePhone));
+  ASSERT(Hash(described) != Hash(samePhone));
+
+  // Через Reflection сравнивается то же содержимое
+  const google::protobuf::Message& message = phones[1];
+  ASSERT(Equal(message, samePhone));
+  ASSERT_EQUAL(Hash(message), Hash(static_cast<const google::protobuf::Message&>(samePhone)));
+  ASSERT(Hash(signals[0].company()) != Hash(signals[1].company()));
+
+  Name name;
+  name.set_value("ab");
+  Name other;
+  other.set_value("a");
+  other.set_type(Name::SYNONYM);
+  ASSERT(Hash(name) != Hash(other));
+}
+
+void TestBatchMerge() {
+  Providers providers;
+  providers[31415].set_priority(10);
+  providers[271828].set_priority(10);
+  providers[100500].set_priority(3);
+
+  // Организация i получает первые i % 4 сигналов примера
+  auto example = GenerateSignals();
+  vector<pair<uint64_t, Signals>> groups;
+  for (uint64_t id = 100; id < 150; ++id) {
+    groups.emplace_back(id, Signals(example.begin(), example.begin() + id % 4));
+    if (id % 4 == 0) {
+      groups.back().second.emplace_back().set_provider_id(31415);
+    }
+  }
+
+  for (size_t threadCount : {1, 4}) {
+    vector<pair<uint64_t, string>> merged;
+    BatchMerger* self = nullptr;
+    BatchMerger merger(providers, [&merged, &self](uint64_t id, const Company& company) {
+      merged.emplace_back(id, company.SerializeAsString());
+      // Статистика доступна и из sink: в ней только уже выданные пакеты
+      ASSERT(self->GetStats().companies < merged.size());
+    }, {.thread_count = threadCount, .batch_size = 3, .max_queued_batches = 2});
+    self = &merger;
+    for (const auto& [id, signals] : groups) {
+      for (const auto& signal : signals) {
+        // Сигналы можно и копировать на арену пакета, и строить прямо на ней
+        if (id % 2 == 0) {
+          merger.Add(id, signal);
+        } else {
+          merger.NewSignal(id) = signal;
+        }
+      }
+    }
+    merger.Finish();
+
+    ASSERT_EQUAL(merged.size(), groups.size());
+    for (size_t i = 0; i < groups.size(); ++i) {
+      ASSERT_EQUAL(merged[i].first, groups[i].first);
+      ASSERT_EQUAL(merged[i].second, Merge(groups[i].second, providers).SerializeAsString());
+    }
+    ASSERT_EQUAL(merger.GetStats().companies, groups.size());
+    ASSERT(merger.GetStats().arena_bytes > 0);
+  }
+
+  // Неизвестный поставщик — ошибка слияния, она доходит до Finish
+  BatchMerger failing(providers, [](uint64_t, const Company&) {}, {.thread_count = 2, .batch_size = 1});
+  failing.Add(1, example[0]);
+  Signal unknown;
+  unknown.set_provider_id(42);
+  unknown.mutable_company()->add_urls()->set_value("http://unknown/");
+  failing.Add(2, unknown);
+  try {
+    failing.Finish();
+    ASSERT(false);
+  } catch (const out_of_range&) {
+  }
+}
+
+void TestProviderPriorities() {
+  Providers providers;
+  providers[31415].set_priority(10);
+  providers[271828].set_priority(10);
+  providers[100500].set_priority(3);
+
+  // Идентификаторы из примера плотные, а с огромным идентификатором — уже нет
+  Providers sparse = providers;
+  sparse[1ULL << 60].set_priority(7);
+  for (const auto& table : {providers, sparse}) {
+    ProviderPriorities priorities(table);
+    ASSERT_EQUAL(priorities.size(), table.size());
+    for (uint64_t id : {31415, 271828, 100500}) {
+      ASSERT(priorities.Find(id) == table.at(id).priority());
+    }
+    ASSERT(!priorities.Find(42));
+    ASSERT(!priorities.Find(100501));
+    ASSERT(!priorities.Find(UINT64_MAX));
+  }
+  ASSERT(ProviderPriorities(sparse).Find(1ULL << 60) == 7u);
+  ASSERT(!ProviderPriorities().Find(0));
+
+  auto signals = GenerateSignals();
+  ASSERT(Merge(signals, ProviderPriorities(providers)) == Merge(signals, providers));
+  ASSERT(Merge(signals, ProviderPriorities(sparse)) == Merge(signals, providers));
+
+  // Сигнал неизвестного поставщика без данных не мешает слиянию
+  signals.emplace_back().set_provider_id(42);
+  ASSERT(Merge(signals, ProviderPriorities(providers)) == Merge(signals, providers));
+  signals.back().mutable_company()->add_urls()->set_value("http://unknown/");
+  try {
+    Merge(signals, ProviderPriorities(providers));
+    ASSERT(false);
+  } catch (const out_of_range&) {
+  }
+}
+
+void TestMergeState() {
+  Providers providers;
+  providers[31415].set_priority(10);
+  providers[271828].set_priority(10);
+  providers[100500].set_priority(3);
+  providers[7].set_priority(1);
+  providers[8].set_priority(20);
+  auto priorities = ProviderPriorities(providers);
+
+  auto signals = GenerateSignals();
+  auto state = BuildMergeState(signals, priorities);
+  ASSERT(state.company() == Merge(signals, providers));
+
+  // Состояние переживает сохранение
+  MergeState restored;
+  ASSERT(restored.ParseFromString(state.SerializeAsString()));
+
+  // Новый сигнал менее приоритетного поставщика ничего не меняет
+  Signal low;
+  low.set_provider_id(7);
+  low.mutable_company()->add_urls()->set_value("http://low/");
+  ASSERT(ApplySignal(restored, low, priorities));
+  ASSERT(restored.company() == state.company());
+
+  // Более приоритетный поставщик заменяет сайты, повторы отбрасываются
+  Signal high;
+  high.set_provider_id(8);
+  high.mutable_company()->add_urls()->set_value("https://рога-и-копыта.рф/");
+  high.mutable_company()->add_urls()->set_value("https://рога-и-копыта.рф/");
+  ASSERT(ApplySignal(restored, high, priorities));
+  signals.push_back(low);
+  signals.push_back(high);
+  ASSERT(restored.company() == Merge(signals, providers));
+  ASSERT_EQUAL(restored.company().urls_size(), 1);
+
+  // Изменённый сигнал победителя без прежнего адреса требует полного слияния
+  Signal changed = signals[0];
+  changed.mutable_company()->clear_address();
+  auto before = restored.SerializeAsString();
+  ASSERT(!ApplySignal(restored, changed, priorities));
+  ASSERT_EQUAL(restored.SerializeAsString(), before);
+
+  // Новый адрес не спасает: от поставщика остались названия и телефоны
+  changed.mutable_company()->mutable_address()->set_formatted("Brazil, Rio de Janeiro");
+  ASSERT(!ApplySignal(restored, changed, priorities));
+
+  // Изменённое время работы единственного его поставщика заменяет прежнее
+  providers[9].set_priority(30);
+  priorities = ProviderPriorities(providers);
+  Signal hours;
+  hours.set_provider_id(9);
+  hours.mutable_company()->mutable_working_time()->set_formatted("Круглосуточно");
+  ASSERT(ApplySignal(restored, hours, priorities));
+  hours.mutable_company()->mutable_working_time()->set_formatted("Ежедневно с 8 до 20");
+  ASSERT(ApplySignal(restored, hours, priorities));
+  signals.push_back(hours);
+  ASSERT(restored.company() == Merge(signals, providers));
+
+  // Победитель присылает поле с более ранней датой: теперь должен победить
+  // другой поставщик того же приоритета, и без полного слияния не обойтись
+  {
+    Signals dated(2);
+    dated[0].set_provider_id(31415);
+    dated[0].set_update_date(5);
+    dated[0].mutable_company()->mutable_address()->set_formatted("X");
+    dated[1].set_provider_id(271828);
+    dated[1].set_update_date(3);
+    dated[1].mutable_company()->mutable_address()->set_formatted("Y");
+    auto datedState = BuildMergeState(dated, priorities);
+    ASSERT_EQUAL(datedState.company().address().formatted(), "X");
+
+    dated[0].set_update_date(1);
+    dated[0].mutable_company()->mutable_address()->set_formatted("Z");
+    ASSERT(!ApplySignal(datedState, dated[0], priorities));
+    datedState = BuildMergeState(dated, priorities);
+    ASSERT_EQUAL(datedState.company().address().formatted(), "Y");
+    ASSERT(datedState.company() == Merge(dated, providers));
+  }
+
+  // Хешей меньше, чем значений: состояние испорчено, нужно полное слияние
+  {
+    // Поставщик с приоритетом победителя сайтов: его сайты сливаются с прежними
+    providers[10].set_priority(20);
+    priorities = ProviderPriorities(providers);
+    Signal url;
+    url.set_provider_id(10);
+    url.mutable_company()->add_urls()->set_value("http://other/");
+    auto intact = restored;
+    ASSERT(ApplySignal(intact, url, priorities));
+    ASSERT_EQUAL(intact.company().urls_size(), 2);
+    auto corrupted = restored;
+    corrupted.mutable_urls()->mutable_hashes()->RemoveLast();
+    ASSERT(!ApplySignal(corrupted, url, priorities));
+  }
+
+  Signal unknown;
+  unknown.set_provider_id(42);
+  ASSERT(ApplySignal(restored, unknown, priorities));
+  unknown.mutable_company()->add_urls()->set_value("http://unknown/");
+  try {
+    ApplySignal(restored, unknown, priorities);
+    ASSERT(false);
+  } catch (const out_of_range&) {
+  }
+}
+
+void TestCompanyStore() {
+  Providers providers;
+  providers[31415].set_priority(10);
+  providers[271828].set_priority(10);
+  providers[100500].set_priority(3);
+  auto example = GenerateSignals();
+
+  // Слитые организации пишутся прямо из BatchMerger; ключи идут через один
+  auto directory = (filesystem::temp_directory_path() / "yellow_pages_test_store").string();
+  filesystem::remove_all(directory);
+  vector<pair<uint64_t, string>> expected;
+  {
+    CompanyStoreWriter writer(directory, {.shard_count = 3, .index_interval = 4});
+    BatchMerger merger(providers, [&](uint64_t id, const Company& company) {
+      writer.Add(id, company);
+      expected.emplace_back(id, company.SerializeAsString());
+    }, {.thread_count = 2, .batch_size = 5});
+    for (uint64_t id = 0; id < 200; id += 2) {
+      for (size_t i = 0; i < 1 + id % 3; ++i) {
+        merger.Add(id, example[i]);
+      }
+    }
+    merger.Finish();
+
+    try {
+      writer.Add(10, Company());
+      ASSERT(false);
+    } catch (const invalid_argument&) {
+    }
+    writer.Finish();
+  }
+
+  auto store = CompanyStore::Open(directory);
+  ASSERT_EQUAL(store.ShardCount(), 3u);
+  ASSERT_EQUAL(store.size(), expected.size());
+  for (const auto& [id, serialized] : expected) {
+    auto found = store.FindSerialized(id);
+    ASSERT(found.has_value());
+    ASSERT_EQUAL(string(*found), serialized);
+    ASSERT_EQUAL(store.Find(id)->SerializeAsString(), serialized);
+  }
+  for (uint64_t id : {1ULL, 99ULL, 201ULL, 1ULL << 40}) {
+    ASSERT(!store.FindSerialized(id));
+    ASSERT(!store.Find(id));
+  }
+
+  // Перезапись не трогает уже открытое хранилище; пустое хранилище открывается
+  CompanyStoreWriter(directory, {.shard_count = 2}).Finish();
+  ASSERT(!CompanyStore::Open(directory).Find(0));
+  ASSERT_EQUAL(store.Find(expected.front().first)->SerializeAsString(), expected.front().second);
+  ASSERT(!filesystem::exists(directory + "/shard-00000.sst.tmp"));
+  ASSERT(!filesystem::exists(directory + "/shard-00002.sst"));
+
+  auto opens = [&directory] {
+    try {
+      CompanyStore::Open(directory);
+      return true;
+    } catch (const runtime_error&) {
+      return false;
+    }
+  };
+  // Шард от другой записи с тем же числом шардов не принимается
+  auto other = directory + "_other";
+  CompanyStoreWriter(other, {.shard_count = 2}).Finish();
+  filesystem::copy_file(other + "/shard-00001.sst", directory + "/shard-00001.sst",
+                        filesystem::copy_options::overwrite_existing);
+  filesystem::remove_all(other);
+  ASSERT(!opens());
+
+  filesystem::remove_all(directory);
+  ASSERT(!opens());
+}
+
 int main() {
   TestRunner tr;
   RUN_TEST(tr, TestMerge);
+  RUN_TEST(tr, TestMergeMatchesReflection);
+  RUN_TEST(tr, TestMergeByUpdateDate);
+  RUN_TEST(tr, TestMessageHash);
+  RUN_TEST(tr, TestBatchMerge);
+  RUN_TEST(tr, TestProviderPriorities);
+  RUN_TEST(tr, TestMergeState);
+  RUN_TEST(tr, TestCompanyStore);
 }
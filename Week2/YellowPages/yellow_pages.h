@@ -1,17 +1,34 @@
 #pragma once
 
 #include "company.pb.h"
-#include "provider.pb.h"
+#include "provider_priorities.h"
 #include "signal.pb.h"
 
-#include <unordered_map>
+#include <span>
 #include <vector>
 
 namespace YellowPages {
   using Signals = std::vector<Signal>;
-  using Providers = std::unordered_map<uint64_t, Provider>;
 
-  // Объединяем данные из сигналов об одной и той же организации
+  // Объединяем данные из сигналов об одной и той же организации.
+  // Одиночное поле берётся из сигнала с наибольшим приоритетом поставщика, среди
+  // них — с самой поздней update_date, при равенстве — из последнего. Повторяющееся
+  // поле объединяет значения сигналов наибольшего приоритета без повторов в порядке
+  // входа. Результат зависит только от входа, так что по Hash(company) из
+  // message_hash.h можно не публиковать заново неизменившиеся организации.
+  // Приоритет поставщика ищется один раз на сигнал; при слиянии многих
+  // организаций стоит один раз собрать ProviderPriorities.
   Company Merge(const Signals& signals, const Providers& providers);
+  Company Merge(const Signals& signals, const ProviderPriorities& priorities);
+
+  // То же для части массива сигналов; результат пишется в пустую company,
+  // которая может лежать на арене
+  void Merge(std::span<const Signal> signals, const Providers& providers, Company& company);
+  void Merge(std::span<const Signal> signals, const ProviderPriorities& priorities, Company& company);
+  void Merge(std::span<const Signal* const> signals, const ProviderPriorities& priorities, Company& company);
+
+  // То же слияние целиком через Reflection, с поиском полей по имени. Оставлено
+  // для сравнения в бенчмарке и проверки типизированного Merge.
+  Company MergeWithReflection(const Signals& signals, const Providers& providers);
 
 }